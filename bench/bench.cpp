@@ -0,0 +1,156 @@
+//Benchmarks of loading, split search, training and inference on synthetic data.
+//bench --benchmark_out=run.json --benchmark_out_format=json writes a run to diff against another one
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "../dataset/dataset.hpp"
+#include "../decision_tree/compiled_tree.hpp"
+#include "../decision_tree/decision_tree.hpp"
+#include "../synthetic/synthetic_data.hpp"
+
+namespace {
+
+//Written once per shape to the temp directory, later runs reuse the file
+std::string writeSyntheticCsv(int nRows, int nFeatures, int nClasses) {
+    std::filesystem::path path = std::filesystem::temp_directory_path() /
+        ("dt_synthetic_" + std::to_string(nRows) + "_" + std::to_string(nFeatures) + "_" + std::to_string(nClasses) + ".csv");
+    if (std::filesystem::exists(path)) {
+        return path.string();
+    }
+    SyntheticOptions options;
+    options.rows = nRows;
+    options.features = nFeatures;
+    options.classes = nClasses;
+    std::string tmpPath = path.string() + ".tmp";
+    writeSyntheticCsv(options, tmpPath);
+    std::filesystem::rename(tmpPath, path);
+    return path.string();
+}
+
+//Loaded once per shape, the benchmarks only read it
+std::shared_ptr<const Dataset> syntheticDataset(int nRows, int nFeatures, int nClasses) {
+    static std::map<std::tuple<int, int, int>, std::shared_ptr<const Dataset>> loaded;
+    auto key = std::make_tuple(nRows, nFeatures, nClasses);
+    auto found = loaded.find(key);
+    if (found != loaded.end()) {
+        return found->second;
+    }
+    auto dataset = std::make_shared<const Dataset>(writeSyntheticCsv(nRows, nFeatures, nClasses), nFeatures);
+    loaded.emplace(key, dataset);
+    return dataset;
+}
+
+//The dataset's rows copied out row-major, as a caller of the batch predictors would hold them
+std::vector<double> rowMajor(const Dataset& dataset) {
+    std::size_t nRows = dataset.totalContainers();
+    std::size_t nFeatures = dataset.totalFeatures();
+    std::vector<double> rows(nRows * nFeatures);
+    for (std::size_t row = 0; row < nRows; row++) {
+        for (std::size_t f = 0; f < nFeatures; f++) {
+            rows[row * nFeatures + f] = dataset.getFeature(row, static_cast<int>(f));
+        }
+    }
+    return rows;
+}
+
+CompiledTree trainedTree(std::shared_ptr<const Dataset> dataset, int depth) {
+    DecisionTree tree(std::move(dataset));
+    TrainOptions options;
+    options.maxDepth = depth;
+    tree.train(options);
+    return tree.compile();
+}
+
+//Args: rows, features
+void BM_CsvLoad(benchmark::State& state) {
+    int nRows = static_cast<int>(state.range(0));
+    int nFeatures = static_cast<int>(state.range(1));
+    std::string path = writeSyntheticCsv(nRows, nFeatures, 4);
+    for (auto _ : state) {
+        Dataset dataset(path, nFeatures);
+        benchmark::DoNotOptimize(dataset.totalContainers());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<std::int64_t>(std::filesystem::file_size(path)));
+    state.SetItemsProcessed(state.iterations() * nRows);
+}
+BENCHMARK(BM_CsvLoad)->ArgNames({"rows", "features"})->Args({10000, 8})->Args({100000, 8})->Args({100000, 32})
+    ->Unit(benchmark::kMillisecond);
+
+//One optimizeNode on a root holding every row, the sorted scan of each feature. Routing the rows is not timed.
+//Args: rows, features, classes
+void BM_OptimizeNode(benchmark::State& state) {
+    DecisionTree tree(syntheticDataset(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)),
+                                       static_cast<int>(state.range(2))));
+    for (auto _ : state) {
+        state.PauseTiming();
+        tree.makeHeadNode();
+        tree.runTree();
+        state.ResumeTiming();
+        tree.getHeadNode()->optimizeNode(tree.getDataset());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0) * state.range(1));
+}
+BENCHMARK(BM_OptimizeNode)->ArgNames({"rows", "features", "classes"})
+    ->Args({10000, 8, 2})->Args({100000, 8, 2})->Args({100000, 8, 16})->Args({100000, 32, 2})
+    ->Unit(benchmark::kMillisecond);
+
+//A full train() to the given depth. Args: rows, features, classes, depth, histogram
+void BM_Train(benchmark::State& state) {
+    DecisionTree tree(syntheticDataset(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)),
+                                       static_cast<int>(state.range(2))));
+    if (state.range(4) != 0) {
+        tree.setSplitMethod(SplitMethod::Histogram);
+    }
+    TrainOptions options;
+    options.maxDepth = static_cast<int>(state.range(3));
+    int leaves = 0;
+    for (auto _ : state) {
+        leaves = tree.train(options);
+    }
+    state.counters["leaves"] = leaves;
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Train)->ArgNames({"rows", "features", "classes", "depth", "histogram"})
+    ->ArgsProduct({{10000, 100000}, {8, 32}, {2, 16}, {4, 12}, {0, 1}})
+    ->Unit(benchmark::kMillisecond);
+
+//CompiledTree::predict one row at a time. Args: rows, features, depth
+void BM_PredictRow(benchmark::State& state) {
+    std::shared_ptr<const Dataset> dataset = syntheticDataset(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), 4);
+    CompiledTree tree = trainedTree(dataset, static_cast<int>(state.range(2)));
+    std::vector<double> rows = rowMajor(*dataset);
+    std::size_t nRows = dataset->totalContainers();
+    std::size_t nFeatures = dataset->totalFeatures();
+    for (auto _ : state) {
+        for (std::size_t row = 0; row < nRows; row++) {
+            benchmark::DoNotOptimize(tree.predict(rows.data() + row * nFeatures));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * nRows);
+}
+BENCHMARK(BM_PredictRow)->ArgNames({"rows", "features", "depth"})->ArgsProduct({{100000}, {8, 32}, {4, 12}})
+    ->Unit(benchmark::kMicrosecond);
+
+//CompiledTree::predictBatch on the calling thread. Args: rows, features, depth
+void BM_PredictBatch(benchmark::State& state) {
+    std::shared_ptr<const Dataset> dataset = syntheticDataset(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)), 4);
+    CompiledTree tree = trainedTree(dataset, static_cast<int>(state.range(2)));
+    std::vector<double> rows = rowMajor(*dataset);
+    std::vector<std::uint16_t> out(dataset->totalContainers());
+    for (auto _ : state) {
+        tree.predictBatch(rows.data(), out.size(), FeatureLayout::RowMajor, out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * out.size());
+}
+BENCHMARK(BM_PredictBatch)->ArgNames({"rows", "features", "depth"})->ArgsProduct({{100000}, {8, 32}, {4, 12}})
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
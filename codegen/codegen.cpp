@@ -0,0 +1,68 @@
+#include "codegen.hpp"
+#include <cmath>
+#include <ios>
+#include <stdexcept>
+
+namespace {
+
+void indent(std::ostream& out, unsigned level) {
+    for (unsigned i = 0; i < level; i++) {
+        out << "    ";
+    }
+}
+
+void writeNode(std::ostream& out, const CompiledTreeView& tree, std::uint32_t index, unsigned level) {
+    if (tree.isLeaf(index)) {
+        indent(out, level);
+        out << "return " << tree.classIds[index] << ";\n";
+        return;
+    }
+    const FlatNode& node = tree.nodes[index];
+    if (!std::isfinite(node.threshold)) {
+        throw std::runtime_error("Cannot generate code for a non finite threshold");
+    }
+    indent(out, level);
+    out << "if (x[" << node.feature << "] >= " << std::hexfloat << node.threshold << std::defaultfloat << ") {\n";
+    writeNode(out, tree, node.child + 1, level + 1);
+    indent(out, level);
+    out << "} else {\n";
+    writeNode(out, tree, node.child, level + 1);
+    indent(out, level);
+    out << "}\n";
+}
+
+//Escapes a class name for a string literal
+std::string quote(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+} // namespace
+
+void writeTreeHeader(std::ostream& out, const CompiledTreeView& tree, const std::vector<std::string>& classNames, const std::string& nameSpace) {
+    if (tree.depth > kMaxGeneratedDepth) {
+        throw std::runtime_error("Tree is " + std::to_string(tree.depth) + " levels deep, code generation supports " + std::to_string(kMaxGeneratedDepth));
+    }
+    out << "//Generated by //codegen:tree_codegen, do not edit\n";
+    out << "#pragma once\n";
+    out << "#include <cstdint>\n\n";
+    out << "namespace " << nameSpace << " {\n\n";
+    out << "constexpr int kFeatureCount = " << tree.nFeatures << ";\n";
+    out << "constexpr int kClassCount = " << tree.nClasses << ";\n";
+    out << "constexpr const char* kClassNames[] = {";
+    for (std::size_t i = 0; i < classNames.size(); i++) {
+        out << (i ? ", " : "") << quote(classNames[i]);
+    }
+    out << "};\n\n";
+    out << "//Class id of a row, x[f] is feature f\n";
+    out << "constexpr std::uint16_t predict(const double* x) {\n";
+    writeNode(out, tree, 0, 1);
+    out << "}\n\n";
+    out << "} // namespace " << nameSpace << "\n";
+}
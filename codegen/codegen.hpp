@@ -0,0 +1,16 @@
+//Turns a compiled tree into a self-contained C++ header with the thresholds baked in as literals
+#pragma once
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../decision_tree/compiled_tree.hpp"
+
+//Deeper trees would run into the compilers' bracket nesting limits
+constexpr unsigned kMaxGeneratedDepth = 200;
+
+//Writes a header declaring, inside namespace nameSpace:
+//  kFeatureCount, kClassCount, kClassNames and
+//  constexpr std::uint16_t predict(const double* x)
+//predict is the tree as nested if/else on x[feature] >= threshold, thresholds as exact hex float literals,
+//so it returns the same class id as CompiledTreeView::predict for every input
+void writeTreeHeader(std::ostream& out, const CompiledTreeView& tree, const std::vector<std::string>& classNames, const std::string& nameSpace);
@@ -0,0 +1,59 @@
+"""Bakes a trained decision tree into a header only cc_library."""
+
+load("@rules_cc//cc:defs.bzl", "cc_library")
+
+def decision_tree_cc_library(name, data, n_features, depth, namespace = None, **kwargs):
+    """Trains a tree on data at build time and wraps the generated header in a cc_library.
+
+    The header is <name>.hpp and declares <namespace>::predict(const double* x), which
+    returns the class id of a row. Rebuilding after data changes regenerates it.
+
+    Args:
+      name: target name, also the header name and the default namespace.
+      data: label of the csv to train on.
+      n_features: leading numeric columns of the csv, the next column is the label.
+      depth: levels to grow.
+      namespace: C++ namespace of the generated code.
+      **kwargs: passed on to the cc_library.
+    """
+    header = name + ".hpp"
+    native.genrule(
+        name = name + "_codegen",
+        srcs = [data],
+        outs = [header],
+        cmd = "$(location //codegen:tree_codegen) $(location %s) %d %d %s $@" % (
+            data,
+            n_features,
+            depth,
+            namespace or name,
+        ),
+        tools = ["//codegen:tree_codegen"],
+    )
+    cc_library(
+        name = name,
+        hdrs = [header],
+        **kwargs
+    )
+
+def decision_tree_model_cc_library(name, model, namespace = None, **kwargs):
+    """Wraps a saved model file, see DecisionTree::save, in a header only cc_library.
+
+    Args:
+      name: target name, also the header name and the default namespace.
+      model: label of the model file.
+      namespace: C++ namespace of the generated code.
+      **kwargs: passed on to the cc_library.
+    """
+    header = name + ".hpp"
+    native.genrule(
+        name = name + "_codegen",
+        srcs = [model],
+        outs = [header],
+        cmd = "$(location //codegen:tree_codegen) $(location %s) %s $@" % (model, namespace or name),
+        tools = ["//codegen:tree_codegen"],
+    )
+    cc_library(
+        name = name,
+        hdrs = [header],
+        **kwargs
+    )
@@ -0,0 +1,38 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include "codegen.hpp"
+#include "../decision_tree/decision_tree.hpp"
+#include "../decision_tree/model_file.hpp"
+
+//tree_codegen <model.dtm> <namespace> <out.hpp>
+//tree_codegen <data.csv> <n_features> <depth> <namespace> <out.hpp>
+//Writes a saved model, or a tree trained on the csv by DecisionTree::train, out as a header
+int main(int argc, char** argv) {
+    if (argc != 4 && argc != 6) {
+        std::cerr << "usage: " << argv[0] << " <model.dtm> <namespace> <out.hpp>\n"
+                  << "       " << argv[0] << " <data.csv> <n_features> <depth> <namespace> <out.hpp>\n";
+        return 1;
+    }
+    try {
+        const char* nameSpace = argv[argc - 2];
+        std::ofstream out(argv[argc - 1]);
+        if (!out.is_open()) {
+            throw std::runtime_error(std::string("Failed to open ") + argv[argc - 1]);
+        }
+        if (argc == 4) {
+            MappedModel model(argv[1]);
+            writeTreeHeader(out, model.view(), model.getClassNames(), nameSpace);
+            return 0;
+        }
+        DecisionTree tree(Dataset(argv[1], std::atoi(argv[2])));
+        TrainOptions options;
+        options.maxDepth = std::atoi(argv[3]);
+        tree.train(options);
+        writeTreeHeader(out, tree.compile().view(), tree.getDataset().getClassNames(), nameSpace);
+    } catch (const std::exception& e) {
+        std::cerr << "tree_codegen: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
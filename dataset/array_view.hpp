@@ -0,0 +1,21 @@
+//Read-only pointer and length over a contiguous array, owned by someone else
+#pragma once
+#include <cstddef>
+
+template <typename T>
+class ArrayView {
+private:
+    const T* data_ = nullptr;
+    std::size_t size_ = 0;
+
+public:
+    ArrayView() = default;
+    ArrayView(const T* data, std::size_t size) : data_(data), size_(size) {}
+
+    const T* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T& operator[](std::size_t index) const { return data_[index]; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+};
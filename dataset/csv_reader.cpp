@@ -0,0 +1,286 @@
+#include "csv_reader.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include "../mapped_file/mapped_file.hpp"
+
+namespace {
+
+struct Chunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    //First row of the chunk in the whole file
+    std::size_t firstRow = 0;
+    std::size_t rows = 0;
+    //Labels in the order they first appear in this chunk, ids into it are chunk local until remapped
+    std::vector<std::string_view> labels;
+};
+
+//Line without its newline, a trailing carriage return is dropped too
+std::string_view nextLine(const char*& cursor, const char* end) {
+    const char* newline = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+    const char* lineEnd = newline ? newline : end;
+    std::string_view line(cursor, lineEnd - cursor);
+    cursor = newline ? newline + 1 : end;
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+std::string_view trim(std::string_view cell) {
+    while (!cell.empty() && (cell.front() == ' ' || cell.front() == '\t')) {
+        cell.remove_prefix(1);
+    }
+    while (!cell.empty() && (cell.back() == ' ' || cell.back() == '\t')) {
+        cell.remove_suffix(1);
+    }
+    return cell;
+}
+
+//Cell starting at pos, pos moves past its comma. Returns false when the line has no more cells
+bool nextCell(std::string_view line, std::size_t& pos, std::string_view& cell) {
+    if (pos > line.size()) {
+        return false;
+    }
+    std::size_t comma = line.find(',', pos);
+    if (comma == std::string_view::npos) {
+        comma = line.size();
+    }
+    cell = line.substr(pos, comma - pos);
+    pos = comma + 1;
+    return true;
+}
+
+double parseNumber(std::string_view cell, std::string_view line) {
+    cell = trim(cell);
+    //from_chars takes no leading plus
+    if (!cell.empty() && cell.front() == '+') {
+        cell.remove_prefix(1);
+    }
+    double value = 0.0;
+    auto result = std::from_chars(cell.data(), cell.data() + cell.size(), value);
+    if (result.ec != std::errc() || result.ptr != cell.data() + cell.size()) {
+        throw std::runtime_error("Failed to parse '" + std::string(cell) + "' as a number on line: " + std::string(line));
+    }
+    return value;
+}
+
+std::size_t countRows(const char* cursor, const char* end) {
+    std::size_t rows = 0;
+    while (cursor < end) {
+        if (!nextLine(cursor, end).empty()) {
+            rows++;
+        }
+    }
+    return rows;
+}
+
+//Parses the features of one line into row of features, returns the label cell
+std::string_view parseRow(std::string_view line, int nFeatures, FeatureMatrix& features, std::size_t row) {
+    std::size_t pos = 0;
+    std::string_view cell;
+    for (int f = 0; f < nFeatures; f++) {
+        if (!nextCell(line, pos, cell)) {
+            throw std::runtime_error("Expected " + std::to_string(nFeatures) + " features on line: " + std::string(line));
+        }
+        features.column(f)[row] = parseNumber(cell, line);
+    }
+    if (!nextCell(line, pos, cell)) {
+        throw std::runtime_error("Missing label on line: " + std::string(line));
+    }
+    return trim(cell);
+}
+
+//Numeric labels go to targets when it is given, otherwise labels are interned into labelIds
+void parseChunk(Chunk& chunk, int nFeatures, FeatureMatrix& features, std::vector<std::uint16_t>& labelIds, std::vector<double>* targets) {
+    std::unordered_map<std::string_view, std::uint16_t> lookup;
+    std::size_t row = chunk.firstRow;
+    const char* cursor = chunk.begin;
+    while (cursor < chunk.end) {
+        std::string_view line = nextLine(cursor, chunk.end);
+        if (line.empty()) {
+            continue;
+        }
+        std::string_view label = parseRow(line, nFeatures, features, row);
+        if (targets != nullptr) {
+            (*targets)[row++] = parseNumber(label, line);
+            continue;
+        }
+        auto it = lookup.find(label);
+        if (it == lookup.end()) {
+            if (chunk.labels.size() > std::numeric_limits<std::uint16_t>::max()) {
+                throw std::runtime_error("Too many distinct labels, class ids are 16 bit");
+            }
+            it = lookup.emplace(label, static_cast<std::uint16_t>(chunk.labels.size())).first;
+            chunk.labels.push_back(label);
+        }
+        labelIds[row++] = it->second;
+    }
+}
+
+} // namespace
+
+CsvColumns readCsvColumns(const std::string& filePath, int nFeatures, ThreadPool* pool, LabelType labelType) {
+    if (nFeatures <= 0) {
+        throw std::runtime_error("A CSV needs at least one feature column");
+    }
+    MappedFile file(filePath);
+    const char* begin = reinterpret_cast<const char*>(file.data());
+    const char* end = begin + file.size();
+
+    //Cut at the first newline after every even share, so no line straddles two chunks
+    std::size_t maxChunks = pool ? static_cast<std::size_t>(pool->size()) * 4 : 1;
+    std::size_t nChunks = std::max<std::size_t>(1, std::min(maxChunks, file.size() / kMinCsvChunkBytes));
+    std::vector<Chunk> chunks;
+    const char* cursor = begin;
+    for (std::size_t i = 1; i <= nChunks && cursor < end; i++) {
+        const char* cut = i == nChunks ? end : std::max(cursor, begin + file.size() / nChunks * i);
+        if (cut < end) {
+            const char* newline = static_cast<const char*>(std::memchr(cut, '\n', end - cut));
+            cut = newline ? newline + 1 : end;
+        }
+        Chunk chunk;
+        chunk.begin = cursor;
+        chunk.end = cut;
+        chunks.push_back(std::move(chunk));
+        cursor = cut;
+    }
+
+    auto forEachChunk = [&](const std::function<void(std::size_t)>& body) {
+        if (pool) {
+            pool->parallelFor(chunks.size(), body);
+        } else {
+            for (std::size_t i = 0; i < chunks.size(); i++) {
+                body(i);
+            }
+        }
+    };
+    forEachChunk([&](std::size_t i) { chunks[i].rows = countRows(chunks[i].begin, chunks[i].end); });
+    std::size_t nRows = 0;
+    for (Chunk& chunk : chunks) {
+        chunk.firstRow = nRows;
+        nRows += chunk.rows;
+    }
+
+    CsvColumns columns;
+    columns.features = FeatureMatrix(nRows, nFeatures);
+    if (labelType == LabelType::Numeric) {
+        columns.targets.resize(nRows);
+        forEachChunk([&](std::size_t i) { parseChunk(chunks[i], nFeatures, columns.features, columns.labelIds, &columns.targets); });
+        return columns;
+    }
+    columns.labelIds.resize(nRows);
+    forEachChunk([&](std::size_t i) { parseChunk(chunks[i], nFeatures, columns.features, columns.labelIds, nullptr); });
+
+    //Chunks in file order, each with its labels in first appearance order, gives the file's first appearance order
+    std::unordered_map<std::string_view, std::uint16_t> lookup;
+    std::vector<std::vector<std::uint16_t>> remaps(chunks.size());
+    for (std::size_t i = 0; i < chunks.size(); i++) {
+        for (std::string_view label : chunks[i].labels) {
+            auto it = lookup.find(label);
+            if (it == lookup.end()) {
+                if (columns.labels.size() > std::numeric_limits<std::uint16_t>::max()) {
+                    throw std::runtime_error("Too many distinct labels, class ids are 16 bit");
+                }
+                it = lookup.emplace(label, static_cast<std::uint16_t>(columns.labels.size())).first;
+                columns.labels.emplace_back(label);
+            }
+            remaps[i].push_back(it->second);
+        }
+    }
+    forEachChunk([&](std::size_t i) {
+        std::uint16_t* ids = columns.labelIds.data() + chunks[i].firstRow;
+        for (std::size_t row = 0; row < chunks[i].rows; row++) {
+            ids[row] = remaps[i][ids[row]];
+        }
+    });
+    return columns;
+}
+
+CsvChunkReader::CsvChunkReader(const std::string& filePath, int nFeatures, std::size_t chunkRows)
+    : file_(filePath, std::ios::binary), path_(filePath), nFeatures_(nFeatures), chunkRows_(chunkRows),
+      buffer_(kReadBytes), features_(chunkRows, nFeatures) {
+    if (!file_.is_open()) {
+        throw std::runtime_error("Failed to open CSV file at " + filePath);
+    }
+    if (nFeatures <= 0 || chunkRows == 0) {
+        throw std::runtime_error("A CSV chunk needs at least one feature column and one row");
+    }
+    labelIds_.reserve(chunkRows);
+    features_.resize(0);
+}
+
+std::size_t CsvChunkReader::bytesFor(int nFeatures, std::size_t chunkRows) {
+    return chunkRows * (nFeatures * sizeof(double) + sizeof(std::uint16_t)) + kReadBytes;
+}
+
+bool CsvChunkReader::fillBuffer() {
+    if (eof_) {
+        return false;
+    }
+    //Keep the unfinished line, only a line longer than the whole buffer makes it grow
+    std::size_t pending = bufferEnd_ - bufferBegin_;
+    std::memmove(buffer_.data(), buffer_.data() + bufferBegin_, pending);
+    bufferBegin_ = 0;
+    bufferEnd_ = pending;
+    if (bufferEnd_ == buffer_.size()) {
+        buffer_.resize(buffer_.size() * 2);
+    }
+    file_.read(buffer_.data() + bufferEnd_, buffer_.size() - bufferEnd_);
+    bufferEnd_ += static_cast<std::size_t>(file_.gcount());
+    if (file_.bad()) {
+        throw std::runtime_error("Failed to read " + path_);
+    }
+    eof_ = file_.eof();
+    return true;
+}
+
+bool CsvChunkReader::next() {
+    std::size_t row = 0;
+    labelIds_.clear();
+    while (row < chunkRows_) {
+        const char* begin = buffer_.data() + bufferBegin_;
+        const char* end = buffer_.data() + bufferEnd_;
+        const char* newline = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+        if (newline == nullptr && !eof_) {
+            fillBuffer();
+            continue;
+        }
+        if (newline == nullptr && begin == end) {
+            break;
+        }
+        const char* cursor = begin;
+        std::string_view line = nextLine(cursor, end);
+        bufferBegin_ = cursor - buffer_.data();
+        if (line.empty()) {
+            continue;
+        }
+        std::string_view label = parseRow(line, nFeatures_, features_, row++);
+        auto it = lookup_.find(label);
+        if (it == lookup_.end()) {
+            if (labels_.size() > std::numeric_limits<std::uint16_t>::max()) {
+                throw std::runtime_error("Too many distinct labels, class ids are 16 bit");
+            }
+            labelKeys_.emplace_back(label);
+            it = lookup_.emplace(labelKeys_.back(), static_cast<std::uint16_t>(labels_.size())).first;
+            labels_.emplace_back(label);
+        }
+        labelIds_.push_back(it->second);
+    }
+    features_.resize(row);
+    return row > 0;
+}
+
+void CsvChunkReader::rewind() {
+    file_.clear();
+    file_.seekg(0);
+    bufferBegin_ = 0;
+    bufferEnd_ = 0;
+    eof_ = false;
+}
@@ -0,0 +1,85 @@
+//Chunked, mostly allocation free CSV loading straight into columns
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "feature_matrix.hpp"
+#include "../thread_pool/thread_pool.hpp"
+
+//How the cell after the features is read
+enum class LabelType {
+    //Interned to class ids
+    Class,
+    //Parsed as a number, the target of a regression
+    Numeric,
+};
+
+//Every line is nFeatures numbers and a label, further cells are ignored and empty lines skipped
+struct CsvColumns {
+    FeatureMatrix features;
+    //labelIds[row] indexes labels, ids follow the order labels first appear in the file. Empty for numeric labels
+    std::vector<std::uint16_t> labelIds;
+    std::vector<std::string> labels;
+    //Numeric labels only, one per row
+    std::vector<double> targets;
+};
+
+//Chunks smaller than this are not worth a pool task
+constexpr std::size_t kMinCsvChunkBytes = 1 << 20;
+
+//Maps the file and splits it at line ends into chunks. One pass counts the rows of every chunk,
+//a second parses each chunk with from_chars into its own rows of the columns. With a pool the
+//chunks are spread over it, the result is the same either way
+CsvColumns readCsvColumns(const std::string& filePath, int nFeatures, ThreadPool* pool = nullptr, LabelType labelType = LabelType::Class);
+
+//Reads a CSV a fixed number of rows at a time, for files that do not fit in memory. Same line rules as readCsvColumns,
+//and labels get the same ids, which stay put across chunks and rewinds
+class CsvChunkReader {
+private:
+    std::ifstream file_;
+    std::string path_;
+    int nFeatures_ = 0;
+    std::size_t chunkRows_ = 0;
+    //Bytes read but not parsed yet, [bufferBegin_, bufferEnd_) always starts at a line
+    std::vector<char> buffer_;
+    std::size_t bufferBegin_ = 0;
+    std::size_t bufferEnd_ = 0;
+    bool eof_ = false;
+    FeatureMatrix features_;
+    std::vector<std::uint16_t> labelIds_;
+    std::vector<std::string> labels_;
+    //Stable copies of the labels for the lookup keys to point at
+    std::deque<std::string> labelKeys_;
+    std::unordered_map<std::string_view, std::uint16_t> lookup_;
+
+    //Moves the unparsed tail to the front and reads after it, false once the file is exhausted
+    bool fillBuffer();
+
+public:
+    //Bytes read from the file at a time
+    static constexpr std::size_t kReadBytes = 1 << 20;
+
+    CsvChunkReader(const std::string& filePath, int nFeatures, std::size_t chunkRows);
+    CsvChunkReader(const CsvChunkReader&) = delete;
+    CsvChunkReader& operator=(const CsvChunkReader&) = delete;
+
+    //Memory a reader with these settings holds, give or take an overlong line
+    static std::size_t bytesFor(int nFeatures, std::size_t chunkRows);
+
+    //Loads up to chunkRows rows, false when the file has none left
+    bool next();
+    //Back to the first row, the labels seen so far are kept
+    void rewind();
+
+    //The current chunk
+    std::size_t rows() const { return features_.rows(); }
+    const FeatureMatrix& features() const { return features_; }
+    const std::vector<std::uint16_t>& labelIds() const { return labelIds_; }
+    //Every label seen so far, indexed by id
+    const std::vector<std::string>& labels() const { return labels_; }
+};
@@ -0,0 +1,114 @@
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <gtest/gtest.h>
+#include "csv_reader.hpp"
+#include "../thread_pool/thread_pool.hpp"
+
+namespace {
+
+constexpr int kFeatures = 3;
+constexpr int kThreads = 4;
+
+struct ExpectedCsv {
+    std::vector<std::vector<double>> columns = std::vector<std::vector<double>>(kFeatures);
+    std::vector<std::uint16_t> labelIds;
+    std::vector<std::string> labels;
+};
+
+//Several times kMinCsvChunkBytes, so a pool cuts it into chunks. Labels are most of every line, so the even
+//share cuts land inside them, and every sixth of the file brings in labels the earlier ones never used
+ExpectedCsv writeLargeCsv(const std::string& path, const std::string& lineEnd) {
+    ExpectedCsv expected;
+    std::unordered_map<std::string, std::uint16_t> ids;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    std::size_t nRows = 6 * kMinCsvChunkBytes / 64;
+    for (std::size_t row = 0; row < nRows; row++) {
+        std::size_t region = row * 6 / nRows;
+        std::string label = "label_with_a_long_name_to_straddle_chunk_cuts_" + std::to_string(region * 3 + row % (region + 2));
+        for (int f = 0; f < kFeatures; f++) {
+            double value = static_cast<double>((row * 7919 + f * 104729) % 100003) / 1000.0;
+            expected.columns[f].push_back(value);
+            out << value << ",";
+        }
+        out << label << lineEnd;
+        auto it = ids.emplace(label, static_cast<std::uint16_t>(expected.labels.size())).first;
+        if (it->second == expected.labels.size()) {
+            expected.labels.push_back(label);
+        }
+        expected.labelIds.push_back(it->second);
+    }
+    return expected;
+}
+
+void expectColumns(const ExpectedCsv& expected, const CsvColumns& actual) {
+    ASSERT_EQ(actual.features.rows(), expected.labelIds.size());
+    ASSERT_EQ(actual.features.features(), static_cast<std::size_t>(kFeatures));
+    for (int f = 0; f < kFeatures; f++) {
+        const double* column = actual.features.column(f);
+        for (std::size_t row = 0; row < expected.labelIds.size(); row++) {
+            ASSERT_EQ(column[row], expected.columns[f][row]) << "feature " << f << " row " << row;
+        }
+    }
+    EXPECT_EQ(actual.labels, expected.labels);
+    EXPECT_EQ(actual.labelIds, expected.labelIds);
+}
+
+void writeFile(const std::string& path, const std::string& text) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+}
+
+class CsvReaderTest : public ::testing::TestWithParam<std::string> {
+protected:
+    ThreadPool pool_{kThreads};
+    std::string path_ = ::testing::TempDir() + "csv_reader_test.csv";
+};
+
+TEST_P(CsvReaderTest, ChunkedParseMatchesTheSerialOne) {
+    ExpectedCsv expected = writeLargeCsv(path_, GetParam());
+    ASSERT_GT(expected.labels.size(), 6u);
+    expectColumns(expected, readCsvColumns(path_, kFeatures, nullptr));
+    expectColumns(expected, readCsvColumns(path_, kFeatures, &pool_));
+}
+
+INSTANTIATE_TEST_SUITE_P(LineEnds, CsvReaderTest, ::testing::Values("\n", "\r\n"));
+
+TEST(CsvReaderSmallTest, ReadsCrlfLines) {
+    std::string path = ::testing::TempDir() + "csv_reader_crlf.csv";
+    writeFile(path, "1.5,2,3,b\r\n\r\n4,+5,6e-1, a \r\n7,8,9,b");
+    ThreadPool pool(kThreads);
+    for (ThreadPool* p : {static_cast<ThreadPool*>(nullptr), &pool}) {
+        CsvColumns columns = readCsvColumns(path, kFeatures, p);
+        ASSERT_EQ(columns.features.rows(), 3u);
+        EXPECT_EQ(columns.labels, (std::vector<std::string>{"b", "a"}));
+        EXPECT_EQ(columns.labelIds, (std::vector<std::uint16_t>{0, 1, 0}));
+        EXPECT_EQ(columns.features.column(0)[0], 1.5);
+        EXPECT_EQ(columns.features.column(1)[1], 5.0);
+        EXPECT_EQ(columns.features.column(2)[1], 0.6);
+        EXPECT_EQ(columns.features.column(2)[2], 9.0);
+    }
+}
+
+TEST(CsvReaderSmallTest, RejectsAMalformedNumber) {
+    std::string path = ::testing::TempDir() + "csv_reader_malformed.csv";
+    writeFile(path, "1,2,3,a\n4,5x,6,b\n");
+    ThreadPool pool(kThreads);
+    EXPECT_THROW(readCsvColumns(path, kFeatures, nullptr), std::runtime_error);
+    EXPECT_THROW(readCsvColumns(path, kFeatures, &pool), std::runtime_error);
+    writeFile(path, "1,2,3,4\n4,5,6,seven\n");
+    EXPECT_THROW(readCsvColumns(path, kFeatures, nullptr, LabelType::Numeric), std::runtime_error);
+}
+
+TEST(CsvReaderSmallTest, RejectsAMalformedNumberInALaterChunk) {
+    std::string path = ::testing::TempDir() + "csv_reader_malformed_late.csv";
+    writeLargeCsv(path, "\n");
+    std::ofstream(path, std::ios::binary | std::ios::app) << "1,2,oops,label\n";
+    ThreadPool pool(kThreads);
+    EXPECT_THROW(readCsvColumns(path, kFeatures, &pool), std::runtime_error);
+}
+
+} // namespace
@@ -1,35 +1,79 @@
 #include "dataset.hpp"
-#include <fstream>
+#include <algorithm>
+#include <limits>
+#include <numeric>
 #include <stdexcept>
-#include <sstream>
-void Dataset::readCsvToContainers(const std::string& filePath = "./data/iris.data", int featureLength = 4) {
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open CSV file at " + filePath);
+#include "csv_reader.hpp"
+#include "../profiling/profiler.hpp"
+void Dataset::readCsvToContainers(const std::string& filePath, int featureLength, ThreadPool* pool, LabelType labelType) {
+    DT_PROFILE_SCOPE(Load);
+    CsvColumns columns = readCsvColumns(filePath, featureLength, pool, labelType);
+    features_ = std::move(columns.features);
+    labelType_ = labelType;
+    if (labelType == LabelType::Numeric) {
+        targetStorage_ = std::move(columns.targets);
+        targets_ = ArrayView<double>(targetStorage_.data(), targetStorage_.size());
+        totalContainers_ = static_cast<int>(targetStorage_.size());
+        return;
     }
+    classIdStorage_ = std::move(columns.labelIds);
+    classIds_ = ArrayView<std::uint16_t>(classIdStorage_.data(), classIdStorage_.size());
+    for (const std::string& label : columns.labels) {
+        internLabel(label);
+    }
+    totalContainers_ = static_cast<int>(classIdStorage_.size());
+}
 
-    std::string line;
+std::uint16_t Dataset::internLabel(const std::string& label) {
+    auto it = classLookup_.find(label);
+    if (it != classLookup_.end()) {
+        return it->second;
+    }
+    if (classNames_.size() > std::numeric_limits<std::uint16_t>::max()) {
+        throw std::runtime_error("Too many distinct labels, class ids are 16 bit");
+    }
+    std::uint16_t classId = static_cast<std::uint16_t>(classNames_.size());
+    classNames_.push_back(label);
+    classLookup_.emplace(label, classId);
+    return classId;
+}
 
-    while (std::getline(file, line)) {
-        if (line.empty()) {
-            continue;
-        }
-        std::vector<double> features;
-        std::stringstream ss(line);
-        std::string cell;
-        //Parse each item into an object which contains a feature vector of doubles and a classification string
-        int i = 0;
-        while (std::getline(ss, cell, ',') && i < featureLength) {
-            i++;
-            features.push_back(std::stod(cell));
-        }
-        std::unique_ptr<DataContainer> container = std::make_unique<DataContainer>(DataContainer(features, cell));
-        this->allContainers_.push_back(std::move(container));
-        totalContainers_++;
-        if (features.empty()) {
-            throw std::runtime_error("Feature vector is empty after parsing line: " + line);
-        }
+void Dataset::buildSortedIndex(ThreadPool* pool) {
+    DT_PROFILE_SCOPE(Presort);
+    if (static_cast<std::uint64_t>(totalContainers_) > std::numeric_limits<std::uint32_t>::max()) {
+        throw std::runtime_error("Too many rows, sorted indices are 32 bit");
+    }
+    std::size_t nRows = totalContainers_;
+    sortedRowStorage_.resize(features_.features() * nRows);
+    sortedRows_ = ArrayView<std::uint32_t>(sortedRowStorage_.data(), sortedRowStorage_.size());
+    const FeatureMatrix& features = features_;
+    auto sortFeature = [this, &features, nRows](std::size_t f) {
+        std::uint32_t* order = sortedRowStorage_.data() + f * nRows;
+        std::iota(order, order + nRows, 0);
+        const double* column = features.column(f);
+        std::stable_sort(order, order + nRows, [column](std::uint32_t a, std::uint32_t b) {
+            return column[a] < column[b];
+        });
+    };
+    if (pool) {
+        pool->parallelFor(features_.features(), sortFeature);
+        return;
     }
+    for (std::size_t f = 0; f < features_.features(); f++) {
+        sortFeature(f);
+    }
+}
 
-    return;
-}
\ No newline at end of file
+DataContainer Dataset::getContainer(int index) const {
+    if (index < 0 || index >= totalContainers_) {
+        throw std::out_of_range("Row " + std::to_string(index) + " is out of range");
+    }
+    std::vector<double> features(features_.features());
+    for (std::size_t f = 0; f < features.size(); f++) {
+        features[f] = features_.at(index, f);
+    }
+    if (isRegression()) {
+        return DataContainer(index, features, std::to_string(targets_[index]));
+    }
+    return DataContainer(index, features, classNames_[classIds_[index]]);
+}
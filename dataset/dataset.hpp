@@ -1,26 +1,91 @@
 //Holds individual training examples
 #pragma once
+#include <cstdint>
 #include <memory>
+#include <stdexcept>
 #include <vector>
 #include <string>
+#include <unordered_map>
 #include "../data_container/data_container.hpp"
+#include "array_view.hpp"
+#include "csv_reader.hpp"
+#include "feature_matrix.hpp"
+#include "../mapped_file/mapped_file.hpp"
+#include "../thread_pool/thread_pool.hpp"
+struct CacheSource;
+
 class Dataset {
 private:
-    std::vector<std::unique_ptr<DataContainer>> allContainers_;
+    //Column-major, a pass over one feature is a stride-1 scan
+    FeatureMatrix features_;
+    //Labels interned to dense ids, classIds_[row] indexes classNames_
+    ArrayView<std::uint16_t> classIds_;
+    std::vector<std::string> classNames_;
+    std::unordered_map<std::string, std::uint16_t> classLookup_;
+    //Numeric labels take the place of the class ids in a regression dataset, which has no classes
+    LabelType labelType_ = LabelType::Class;
+    ArrayView<double> targets_;
+    std::vector<double> targetStorage_;
+    //For every feature, all rows ordered by ascending value (ties keep row order), feature after feature.
+    //Sorted once per dataset
+    ArrayView<std::uint32_t> sortedRows_;
+    //Back classIds_ and sortedRows_ when they were built here rather than mapped from a cache
+    std::vector<std::uint16_t> classIdStorage_;
+    std::vector<std::uint32_t> sortedRowStorage_;
+    //Mapped cache file the columns, ids and sorted rows point into, if loaded from one
+    std::shared_ptr<const MappedFile> cache_;
     int totalContainers_ = 0;
-    //Initalizes allContainers_
-    void readCsvToContainers(const std::string& filePath, int featureLength);
+    //Initalizes features_ and classIds_, chunks of the file are parsed on the pool when there is one
+    void readCsvToContainers(const std::string& filePath, int featureLength, ThreadPool* pool, LabelType labelType = LabelType::Class);
+    std::uint16_t internLabel(const std::string& label);
+    void buildSortedIndex(ThreadPool* pool);
+    //Points every array at a cache file that readCacheHeader accepted
+    explicit Dataset(std::shared_ptr<const MappedFile> cache);
+    //Binary cache of this dataset, see dataset_cache.hpp. Written next to the target and renamed over it
+    void writeCache(const std::string& cachePath, const CacheSource& source) const;
 public:
     int totalContainers() const  {
         return totalContainers_;
     }
+    int totalFeatures() const { return static_cast<int>(features_.features()); }
+    int totalClasses() const { return static_cast<int>(classNames_.size()); }
     Dataset() {
-        readCsvToContainers("./data/iris.data", 4);
+        readCsvToContainers("./data/iris.data", 4, nullptr);
+        buildSortedIndex(nullptr);
     }
-    Dataset(std::string filename, int nFeatures) {
-        readCsvToContainers(filename, nFeatures);
+    //The pool only speeds up loading, the dataset is the same without it. LabelType::Numeric reads the
+    //last cell as a regression target
+    Dataset(std::string filename, int nFeatures, ThreadPool* pool = nullptr, LabelType labelType = LabelType::Class) {
+        readCsvToContainers(filename, nFeatures, pool, labelType);
+        buildSortedIndex(pool);
     };
-    const DataContainer& getContainer(int index) const { return *allContainers_.at(index); }
+    //Same dataset as Dataset(csvPath, nFeatures, pool), through a binary cache file at cachePath
+    //(csvPath + ".cache" when empty). A cache matching the csv's size, modification time or content hash
+    //is mapped without any parsing, anything else is parsed and the cache rewritten. A damaged cache is rebuilt,
+    //one that cannot be written is skipped. Class labels only
+    static Dataset loadCached(const std::string& csvPath, int nFeatures, ThreadPool* pool = nullptr, std::string cachePath = "");
+    //Whether the columns live in a mapped cache file
+    bool isMapped() const { return cache_ != nullptr; }
+    //Contiguous values of one feature, indexed by row
+    const double* getFeatureColumn(int feature) const { return features_.column(feature); }
+    double getFeature(std::size_t row, int feature) const { return features_.at(row, feature); }
+    //Distance between two feature columns, getFeatureColumn(0) + row read with this stride is the row in place
+    std::size_t getFeatureStride() const { return features_.stride(); }
+    bool isRegression() const { return labelType_ == LabelType::Numeric; }
+    double getTarget(std::size_t row) const { return targets_[row]; }
+    ArrayView<double> getTargets() const { return targets_; }
+    std::uint16_t getClassId(std::size_t row) const { return classIds_[row]; }
+    ArrayView<std::uint16_t> getClassIds() const { return classIds_; }
+    const std::string& getClassName(std::uint16_t classId) const { return classNames_.at(classId); }
+    const std::vector<std::string>& getClassNames() const { return classNames_; }
+    ArrayView<std::uint32_t> getSortedRows(int feature) const {
+        if (feature < 0 || feature >= totalFeatures()) {
+            throw std::out_of_range("Feature " + std::to_string(feature) + " is out of range");
+        }
+        return ArrayView<std::uint32_t>(sortedRows_.data() + static_cast<std::size_t>(feature) * totalContainers_, totalContainers_);
+    }
+    //Gathers one row into a standalone container, the container id is the row index
+    DataContainer getContainer(int index) const;
+
 
-    
-};
\ No newline at end of file
+};
@@ -0,0 +1,205 @@
+#include "dataset_cache.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "dataset.hpp"
+#include "../profiling/profiler.hpp"
+
+namespace {
+
+constexpr std::uint64_t kSectionAlignment = 64;
+constexpr std::uint64_t kDoublesPerLine = kSectionAlignment / sizeof(double);
+
+std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+//Section offsets from the start of the file, derived from the header counts alone
+struct CacheLayout {
+    std::uint64_t columns;
+    std::uint64_t classIds;
+    std::uint64_t sortedRows;
+    std::uint64_t nameOffsets;
+    std::uint64_t names;
+    std::uint64_t end;
+
+    explicit CacheLayout(const DatasetCacheHeader& header) {
+        columns = sizeof(DatasetCacheHeader);
+        classIds = alignUp(columns + header.nFeatures * header.stride * sizeof(double), kSectionAlignment);
+        sortedRows = alignUp(classIds + header.nRows * sizeof(std::uint16_t), kSectionAlignment);
+        nameOffsets = alignUp(sortedRows + header.nFeatures * header.nRows * sizeof(std::uint32_t), kSectionAlignment);
+        names = nameOffsets + (std::uint64_t(header.nClasses) + 1) * sizeof(std::uint32_t);
+        end = names + header.namesSize;
+    }
+};
+
+} // namespace
+
+CacheSource statCacheSource(const std::string& path) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) {
+        throw std::runtime_error("Failed to stat " + path + ": " + std::strerror(errno));
+    }
+    CacheSource source;
+    source.size = static_cast<std::uint64_t>(info.st_size);
+    source.modified = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    return source;
+}
+
+std::uint64_t hashCacheSource(const std::string& path) {
+    MappedFile file(path);
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (std::size_t i = 0; i < file.size(); i++) {
+        hash ^= file.data()[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+const DatasetCacheHeader* readCacheHeader(const MappedFile& file) {
+    if (file.size() < sizeof(DatasetCacheHeader)) {
+        return nullptr;
+    }
+    const DatasetCacheHeader* header = reinterpret_cast<const DatasetCacheHeader*>(file.data());
+    if (std::memcmp(header->magic, kCacheMagic, sizeof(header->magic)) != 0 || header->version != kCacheVersion ||
+        header->byteOrder != kCacheByteOrder) {
+        return nullptr;
+    }
+    //Bound every count by the file size before multiplying them
+    bool countsFit = header->nFeatures > 0 && header->nRows <= static_cast<std::uint64_t>(std::numeric_limits<int>::max()) &&
+                     header->stride == alignUp(header->nRows, kDoublesPerLine) &&
+                     header->stride <= file.size() / sizeof(double) / header->nFeatures &&
+                     header->nClasses <= std::uint64_t(std::numeric_limits<std::uint16_t>::max()) + 1;
+    if (!countsFit || header->fileSize != file.size() || CacheLayout(*header).end != file.size()) {
+        return nullptr;
+    }
+    return header;
+}
+
+Dataset::Dataset(std::shared_ptr<const MappedFile> cache) : cache_(std::move(cache)) {
+    DT_PROFILE_SCOPE(Load);
+    const DatasetCacheHeader* header = readCacheHeader(*cache_);
+    if (header == nullptr) {
+        throw std::runtime_error(cache_->path() + " is not a dataset cache");
+    }
+    CacheLayout layout(*header);
+    const unsigned char* base = cache_->data();
+    std::size_t nRows = header->nRows;
+    features_ = FeatureMatrix::borrow(reinterpret_cast<const double*>(base + layout.columns), nRows, header->nFeatures,
+                                      header->stride, cache_);
+    classIds_ = ArrayView<std::uint16_t>(reinterpret_cast<const std::uint16_t*>(base + layout.classIds), nRows);
+    sortedRows_ = ArrayView<std::uint32_t>(reinterpret_cast<const std::uint32_t*>(base + layout.sortedRows),
+                                           std::size_t(header->nFeatures) * nRows);
+    totalContainers_ = static_cast<int>(nRows);
+    //Split scans index with these without checking, so a damaged or stale cache must not get past here.
+    //One pass over them costs far less than the parse the cache saves
+    for (std::uint16_t classId : classIds_) {
+        if (classId >= header->nClasses) {
+            throw std::runtime_error(cache_->path() + " has a class id out of range");
+        }
+    }
+    for (std::uint32_t row : sortedRows_) {
+        if (row >= nRows) {
+            throw std::runtime_error(cache_->path() + " has a sorted row out of range");
+        }
+    }
+
+    const std::uint32_t* nameOffsets = reinterpret_cast<const std::uint32_t*>(base + layout.nameOffsets);
+    const char* names = reinterpret_cast<const char*>(base + layout.names);
+    for (std::uint32_t c = 0; c < header->nClasses; c++) {
+        if (nameOffsets[c] > nameOffsets[c + 1] || nameOffsets[c + 1] > header->namesSize) {
+            throw std::runtime_error(cache_->path() + " has a bad class name table");
+        }
+        internLabel(std::string(names + nameOffsets[c], nameOffsets[c + 1] - nameOffsets[c]));
+    }
+}
+
+Dataset Dataset::loadCached(const std::string& csvPath, int nFeatures, ThreadPool* pool, std::string cachePath) {
+    if (cachePath.empty()) {
+        cachePath = csvPath + ".cache";
+    }
+    CacheSource source = statCacheSource(csvPath);
+    try {
+        auto cache = std::make_shared<const MappedFile>(cachePath);
+        const DatasetCacheHeader* header = readCacheHeader(*cache);
+        if (header != nullptr && header->nFeatures == static_cast<std::uint32_t>(nFeatures) && header->sourceSize == source.size &&
+            (header->sourceModified == source.modified || header->sourceHash == hashCacheSource(csvPath))) {
+            return Dataset(std::move(cache));
+        }
+    } catch (const std::runtime_error&) {
+        //No cache yet or an unreadable one, both get rebuilt
+    }
+    Dataset dataset(csvPath, nFeatures, pool);
+    source.hash = hashCacheSource(csvPath);
+    try {
+        dataset.writeCache(cachePath, source);
+    } catch (const std::runtime_error&) {
+        //The cache only saves the next parse, a read-only or full disk costs that and nothing else
+    }
+    return dataset;
+}
+
+void Dataset::writeCache(const std::string& cachePath, const CacheSource& source) const {
+    std::vector<std::uint32_t> nameOffsets = {0};
+    std::string names;
+    for (const std::string& name : classNames_) {
+        names += name;
+        if (names.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::runtime_error("Class names are too long for a dataset cache");
+        }
+        nameOffsets.push_back(static_cast<std::uint32_t>(names.size()));
+    }
+
+    DatasetCacheHeader header = {};
+    std::memcpy(header.magic, kCacheMagic, sizeof(header.magic));
+    header.version = kCacheVersion;
+    header.byteOrder = kCacheByteOrder;
+    header.nRows = static_cast<std::uint64_t>(totalContainers_);
+    header.nFeatures = static_cast<std::uint32_t>(totalFeatures());
+    header.nClasses = static_cast<std::uint32_t>(totalClasses());
+    header.stride = alignUp(header.nRows, kDoublesPerLine);
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+    header.sourceHash = source.hash;
+    header.namesSize = static_cast<std::uint32_t>(names.size());
+    CacheLayout layout(header);
+    header.fileSize = layout.end;
+
+    //Written aside and renamed into place, so readers never map a half written cache
+    std::string tempPath = cachePath + ".tmp." + std::to_string(::getpid());
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to open " + tempPath);
+    }
+    std::uint64_t written = 0;
+    //Zero pads up to offset, then writes size bytes
+    auto writeAt = [&](std::uint64_t offset, const void* data, std::size_t size) {
+        static const char zeros[kSectionAlignment * 8] = {};
+        while (written < offset) {
+            std::size_t pad = static_cast<std::size_t>(std::min<std::uint64_t>(offset - written, sizeof(zeros)));
+            out.write(zeros, pad);
+            written += pad;
+        }
+        out.write(static_cast<const char*>(data), size);
+        written += size;
+    };
+    writeAt(0, &header, sizeof(header));
+    for (int f = 0; f < totalFeatures(); f++) {
+        writeAt(layout.columns + f * header.stride * sizeof(double), getFeatureColumn(f), header.nRows * sizeof(double));
+    }
+    writeAt(layout.classIds, classIds_.data(), classIds_.size() * sizeof(std::uint16_t));
+    writeAt(layout.sortedRows, sortedRows_.data(), sortedRows_.size() * sizeof(std::uint32_t));
+    writeAt(layout.nameOffsets, nameOffsets.data(), nameOffsets.size() * sizeof(std::uint32_t));
+    writeAt(layout.names, names.data(), names.size());
+    out.close();
+    if (!out || std::rename(tempPath.c_str(), cachePath.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+        throw std::runtime_error("Failed to write dataset cache " + cachePath);
+    }
+}
@@ -0,0 +1,54 @@
+//Binary columnar cache of a parsed CSV, laid out so a Dataset can point straight into the mapped file
+#pragma once
+#include <cstdint>
+#include <string>
+#include "../mapped_file/mapped_file.hpp"
+
+//File layout, native byte order, every section starts on a 64 byte boundary:
+//  DatasetCacheHeader
+//  columns      nFeatures columns of stride doubles, rows past nRows are zero
+//  classIds     nRows uint16
+//  sortedRows   nFeatures * nRows uint32, Dataset::getSortedRows feature after feature
+//  nameOffsets  nClasses + 1 uint32, class c is names[nameOffsets[c], nameOffsets[c + 1])
+//  names        namesSize bytes of concatenated class names
+struct DatasetCacheHeader {
+    char magic[8];
+    std::uint32_t version;
+    //kCacheByteOrder as written
+    std::uint32_t byteOrder;
+    std::uint64_t nRows;
+    std::uint32_t nFeatures;
+    std::uint32_t nClasses;
+    //Doubles from the start of one column to the next, a multiple of 8
+    std::uint64_t stride;
+    //The csv the cache was built from
+    std::uint64_t sourceSize;
+    std::int64_t sourceModified;
+    std::uint64_t sourceHash;
+    std::uint32_t namesSize;
+    std::uint32_t reserved0;
+    std::uint64_t fileSize;
+    std::uint64_t reserved[6];
+};
+static_assert(sizeof(DatasetCacheHeader) == 128, "DatasetCacheHeader should stay 128 bytes");
+
+constexpr char kCacheMagic[8] = {'D', 'T', 'C', 'A', 'C', 'H', 'E', '\0'};
+constexpr std::uint32_t kCacheVersion = 1;
+constexpr std::uint32_t kCacheByteOrder = 0x01020304;
+
+//What a cache remembers of its csv. Size and modification time are the cheap check,
+//the content hash settles it when only the time moved
+struct CacheSource {
+    std::uint64_t size = 0;
+    //Nanoseconds since the epoch
+    std::int64_t modified = 0;
+    std::uint64_t hash = 0;
+};
+
+//Size and modification time of a file, hash left at 0
+CacheSource statCacheSource(const std::string& path);
+//FNV-1a 64 of the whole file
+std::uint64_t hashCacheSource(const std::string& path);
+
+//Header of a mapped cache, or null when the file is not a complete cache this build can read
+const DatasetCacheHeader* readCacheHeader(const MappedFile& file);
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <sys/stat.h>
+#include <gtest/gtest.h>
+#include "dataset.hpp"
+#include "dataset_cache.hpp"
+
+namespace {
+
+constexpr int kFeatures = 4;
+
+std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::string& bytes) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes;
+}
+
+//Moves a file's modification time by seconds, so a rewrite is never hidden by a coarse clock
+void shiftModified(const std::string& path, long seconds) {
+    struct stat info;
+    ASSERT_EQ(::stat(path.c_str(), &info), 0);
+    struct timespec times[2] = {info.st_atim, info.st_mtim};
+    times[1].tv_sec += seconds;
+    ASSERT_EQ(::utimensat(AT_FDCWD, path.c_str(), times, 0), 0);
+}
+
+void expectSameDataset(const Dataset& expected, const Dataset& actual) {
+    ASSERT_EQ(actual.totalContainers(), expected.totalContainers());
+    ASSERT_EQ(actual.totalFeatures(), expected.totalFeatures());
+    EXPECT_EQ(actual.getClassNames(), expected.getClassNames());
+    std::size_t nRows = expected.totalContainers();
+    for (int f = 0; f < expected.totalFeatures(); f++) {
+        EXPECT_EQ(std::memcmp(actual.getFeatureColumn(f), expected.getFeatureColumn(f), nRows * sizeof(double)), 0) << "feature " << f;
+        ArrayView<std::uint32_t> expectedSorted = expected.getSortedRows(f);
+        ArrayView<std::uint32_t> actualSorted = actual.getSortedRows(f);
+        EXPECT_TRUE(std::equal(expectedSorted.begin(), expectedSorted.end(), actualSorted.begin(), actualSorted.end())) << "feature " << f;
+    }
+    ArrayView<std::uint16_t> expectedIds = expected.getClassIds();
+    ArrayView<std::uint16_t> actualIds = actual.getClassIds();
+    EXPECT_TRUE(std::equal(expectedIds.begin(), expectedIds.end(), actualIds.begin(), actualIds.end()));
+}
+
+class DatasetCacheTest : public ::testing::Test {
+protected:
+    std::string csv_ = ::testing::TempDir() + "dataset_cache_test.csv";
+    std::string cache_ = csv_ + ".cache";
+
+    void SetUp() override {
+        writeFile(csv_, readFile("data/iris.data"));
+        std::remove(cache_.c_str());
+    }
+    Dataset load() const { return Dataset::loadCached(csv_, kFeatures); }
+};
+
+TEST_F(DatasetCacheTest, SecondLoadMapsTheCache) {
+    Dataset parsed = load();
+    EXPECT_FALSE(parsed.isMapped());
+    Dataset mapped = load();
+    EXPECT_TRUE(mapped.isMapped());
+    expectSameDataset(parsed, mapped);
+    expectSameDataset(Dataset(csv_, kFeatures), mapped);
+}
+
+TEST_F(DatasetCacheTest, RebuildsWhenTheContentsChangeAtTheSameSize) {
+    load();
+    std::string text = readFile(csv_);
+    std::size_t digit = text.find("5.1");
+    ASSERT_NE(digit, std::string::npos);
+    text[digit] = '6';
+    writeFile(csv_, text);
+    shiftModified(csv_, 10);
+    Dataset rebuilt = load();
+    EXPECT_FALSE(rebuilt.isMapped());
+    EXPECT_EQ(rebuilt.getFeature(0, 0), 6.1);
+    Dataset mapped = load();
+    EXPECT_TRUE(mapped.isMapped());
+    expectSameDataset(rebuilt, mapped);
+}
+
+TEST_F(DatasetCacheTest, KeepsTheCacheWhenOnlyTheTimeMoves) {
+    Dataset parsed = load();
+    shiftModified(csv_, 10);
+    Dataset mapped = load();
+    EXPECT_TRUE(mapped.isMapped());
+    expectSameDataset(parsed, mapped);
+}
+
+TEST_F(DatasetCacheTest, RebuildsATruncatedCache) {
+    Dataset parsed = load();
+    std::string bytes = readFile(cache_);
+    writeFile(cache_, bytes.substr(0, bytes.size() / 2));
+    Dataset rebuilt = load();
+    EXPECT_FALSE(rebuilt.isMapped());
+    expectSameDataset(parsed, rebuilt);
+    EXPECT_TRUE(load().isMapped());
+}
+
+TEST_F(DatasetCacheTest, RebuildsACacheWithAClassIdOutOfRange) {
+    Dataset parsed = load();
+    std::string bytes = readFile(cache_);
+    DatasetCacheHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    std::size_t classIds = sizeof(DatasetCacheHeader) + header.nFeatures * header.stride * sizeof(double);
+    std::uint16_t badId = static_cast<std::uint16_t>(header.nClasses);
+    std::memcpy(&bytes[classIds + 7 * sizeof(std::uint16_t)], &badId, sizeof(badId));
+    writeFile(cache_, bytes);
+    Dataset rebuilt = load();
+    EXPECT_FALSE(rebuilt.isMapped());
+    expectSameDataset(parsed, rebuilt);
+}
+
+TEST_F(DatasetCacheTest, RebuildsACacheWithASortedRowOutOfRange) {
+    Dataset parsed = load();
+    std::string bytes = readFile(cache_);
+    DatasetCacheHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    std::size_t classIds = sizeof(DatasetCacheHeader) + header.nFeatures * header.stride * sizeof(double);
+    std::size_t sortedRows = (classIds + header.nRows * sizeof(std::uint16_t) + 63) / 64 * 64;
+    std::uint32_t badRow = static_cast<std::uint32_t>(header.nRows);
+    std::memcpy(&bytes[sortedRows + 3 * sizeof(std::uint32_t)], &badRow, sizeof(badRow));
+    writeFile(cache_, bytes);
+    EXPECT_FALSE(load().isMapped());
+}
+
+TEST_F(DatasetCacheTest, LoadsWhenTheCacheCannotBeWritten) {
+    Dataset parsed = Dataset::loadCached(csv_, kFeatures, nullptr, ::testing::TempDir() + "no_such_directory/iris.cache");
+    EXPECT_FALSE(parsed.isMapped());
+    expectSameDataset(Dataset(csv_, kFeatures), parsed);
+}
+
+} // namespace
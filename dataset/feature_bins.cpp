@@ -0,0 +1,72 @@
+#include "feature_bins.hpp"
+#include <algorithm>
+
+FeatureBins::FeatureBins(const Dataset& dataset, int maxBins)
+    : nRows_(dataset.totalContainers()), nFeatures_(dataset.totalFeatures()) {
+    maxBins = std::clamp(maxBins, 2, kMaxBins);
+    codes_.resize(nRows_ * nFeatures_);
+    edges_.resize(nFeatures_);
+    binOffsets_.assign(1, 0);
+    for (int f = 0; f < nFeatures_; f++) {
+        buildEdges(dataset, f, maxBins);
+        encodeFeature(dataset, f);
+        binOffsets_.push_back(binOffsets_.back() + binCount(f));
+    }
+}
+
+void FeatureBins::buildEdges(const Dataset& dataset, int feature, int maxBins) {
+    const double* column = dataset.getFeatureColumn(feature);
+    std::vector<double> sorted;
+    sorted.reserve(nRows_);
+    for (std::uint32_t row : dataset.getSortedRows(feature)) {
+        sorted.push_back(column[row]);
+    }
+    edges_[feature] = edgesFromSorted(sorted.data(), sorted.size(), maxBins);
+}
+
+std::vector<double> FeatureBins::edgesFromSorted(const double* sorted, std::size_t n, int maxBins) {
+    maxBins = std::clamp(maxBins, 2, kMaxBins);
+    //Distinct values and how many rows hold each
+    std::vector<double> values;
+    std::vector<std::size_t> counts;
+    for (std::size_t i = 0; i < n; i++) {
+        if (values.empty() || sorted[i] != values.back()) {
+            values.push_back(sorted[i]);
+            counts.push_back(0);
+        }
+        counts.back()++;
+    }
+
+    std::vector<double> edges;
+    if (values.size() <= static_cast<std::size_t>(maxBins)) {
+        //Few enough distinct values for one bin each, the histogram then sees the same candidates as the exact scan
+        for (std::size_t i = 0; i + 1 < values.size(); i++) {
+            edges.push_back((values[i] + values[i + 1]) / 2.0);
+        }
+        return edges;
+    }
+    //Otherwise cut at roughly equal row counts, never inside a run of equal values
+    double rowsPerBin = static_cast<double>(n) / maxBins;
+    std::size_t seen = 0;
+    for (std::size_t i = 0; i + 1 < values.size() && edges.size() + 1 < static_cast<std::size_t>(maxBins); i++) {
+        seen += counts[i];
+        if (seen >= rowsPerBin * (edges.size() + 1)) {
+            edges.push_back((values[i] + values[i + 1]) / 2.0);
+        }
+    }
+    return edges;
+}
+
+void FeatureBins::encodeFeature(const Dataset& dataset, int feature) {
+    const double* column = dataset.getFeatureColumn(feature);
+    const std::vector<double>& edges = edges_[feature];
+    std::uint8_t* codes = codes_.data() + feature * nRows_;
+    //Walking rows in sorted order only ever moves the bin forward
+    std::size_t bin = 0;
+    for (std::uint32_t row : dataset.getSortedRows(feature)) {
+        while (bin < edges.size() && column[row] >= edges[bin]) {
+            bin++;
+        }
+        codes[row] = static_cast<std::uint8_t>(bin);
+    }
+}
@@ -0,0 +1,41 @@
+//Quantized copy of a Dataset, every feature value is replaced by a one byte bin code
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "dataset.hpp"
+
+class FeatureBins {
+private:
+    std::size_t nRows_ = 0;
+    int nFeatures_ = 0;
+    //Column-major codes, codes_[feature * nRows_ + row]
+    std::vector<std::uint8_t> codes_;
+    //Per feature, ascending bin edges. A value v gets the code of the number of edges <= v,
+    //so splitting at edge k sends exactly the bins >= k right, same as input >= classifierValue
+    std::vector<std::vector<double>> edges_;
+    //Start of each feature's bins in a flattened histogram
+    std::vector<std::size_t> binOffsets_;
+
+    void buildEdges(const Dataset& dataset, int feature, int maxBins);
+    void encodeFeature(const Dataset& dataset, int feature);
+
+public:
+    static constexpr int kMaxBins = 256;
+
+    //maxBins is clamped to [2, 256]
+    explicit FeatureBins(const Dataset& dataset, int maxBins = kMaxBins);
+    //Edges for n ascending values: one bin per distinct value when they fit, otherwise roughly equal row counts per bin
+    static std::vector<double> edgesFromSorted(const double* sorted, std::size_t n, int maxBins);
+
+    std::size_t rows() const { return nRows_; }
+    int features() const { return nFeatures_; }
+    int binCount(int feature) const { return static_cast<int>(edges_[feature].size()) + 1; }
+    std::size_t totalBins() const { return binOffsets_.back(); }
+    std::size_t binOffset(int feature) const { return binOffsets_[feature]; }
+
+    const std::uint8_t* getCodeColumn(int feature) const { return codes_.data() + feature * nRows_; }
+    const std::vector<double>& getEdges(int feature) const { return edges_[feature]; }
+    //The split value between bin edge - 1 and bin edge
+    double getEdge(int feature, int edge) const { return edges_[feature][edge - 1]; }
+};
@@ -0,0 +1,72 @@
+#include "feature_matrix.hpp"
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
+std::unique_ptr<double[], FeatureMatrix::FreeDeleter> FeatureMatrix::allocate(std::size_t nDoubles) {
+    if (nDoubles == 0) {
+        return nullptr;
+    }
+    //aligned_alloc wants the size to be a multiple of the alignment, the stride already guarantees it
+    void* raw = std::aligned_alloc(kAlignment, nDoubles * sizeof(double));
+    if (raw == nullptr) {
+        throw std::bad_alloc();
+    }
+    return std::unique_ptr<double[], FreeDeleter>(static_cast<double*>(raw));
+}
+
+FeatureMatrix::FeatureMatrix(std::size_t nRows, std::size_t nFeatures) : nFeatures_(nFeatures) {
+    reserve(nRows);
+    nRows_ = nRows;
+}
+
+FeatureMatrix FeatureMatrix::borrow(const double* data, std::size_t nRows, std::size_t nFeatures, std::size_t stride,
+                                   std::shared_ptr<const void> owner) {
+    if (owner == nullptr) {
+        throw std::invalid_argument("Borrowed feature columns need an owner");
+    }
+    if (stride < nRows || stride % kDoublesPerLine != 0) {
+        throw std::invalid_argument("Borrowed feature columns need an aligned stride of at least one column");
+    }
+    FeatureMatrix matrix(nFeatures);
+    matrix.base_ = const_cast<double*>(data);
+    matrix.nRows_ = nRows;
+    matrix.stride_ = stride;
+    matrix.owner_ = std::move(owner);
+    return matrix;
+}
+
+void FeatureMatrix::reserve(std::size_t nRows) {
+    if (nRows > stride_ || (owner_ && nRows > nRows_)) {
+        grow(nRows);
+    }
+}
+
+void FeatureMatrix::resize(std::size_t nRows) {
+    reserve(nRows);
+    nRows_ = nRows;
+}
+
+void FeatureMatrix::grow(std::size_t minRows) {
+    std::size_t newStride = std::max(minRows, stride_ * 2);
+    newStride = (newStride + kDoublesPerLine - 1) / kDoublesPerLine * kDoublesPerLine;
+    auto newData = allocate(newStride * nFeatures_);
+    for (std::size_t f = 0; f < nFeatures_; f++) {
+        const double* old = base_ + f * stride_;
+        std::copy(old, old + nRows_, newData.get() + f * newStride);
+    }
+    data_ = std::move(newData);
+    base_ = data_.get();
+    owner_.reset();
+    stride_ = newStride;
+}
+
+void FeatureMatrix::appendRow(const double* values) {
+    if (nRows_ == stride_ || owner_) {
+        grow(nRows_ + 1);
+    }
+    for (std::size_t f = 0; f < nFeatures_; f++) {
+        column(f)[nRows_] = values[f];
+    }
+    nRows_++;
+}
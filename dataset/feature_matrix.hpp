@@ -0,0 +1,60 @@
+//Column-major feature storage, every feature lives in one contiguous 64 byte aligned array
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+
+class FeatureMatrix {
+private:
+    //One cache line, also enough for AVX-512 loads
+    static constexpr std::size_t kAlignment = 64;
+    static constexpr std::size_t kDoublesPerLine = kAlignment / sizeof(double);
+    struct FreeDeleter {
+        void operator()(double* ptr) const { std::free(ptr); }
+    };
+
+    std::unique_ptr<double[], FreeDeleter> data_;
+    //Start of column 0, either data_ or memory borrowed from owner_
+    double* base_ = nullptr;
+    //Keeps borrowed columns alive, null when data_ owns them
+    std::shared_ptr<const void> owner_;
+    std::size_t nRows_ = 0;
+    std::size_t nFeatures_ = 0;
+    //Distance in doubles between the start of two columns, a multiple of a cache line so every column stays aligned
+    std::size_t stride_ = 0;
+
+    static std::unique_ptr<double[], FreeDeleter> allocate(std::size_t nDoubles);
+    //Moves to a bigger stride, copying every column over
+    void grow(std::size_t minRows);
+
+public:
+    FeatureMatrix() = default;
+    explicit FeatureMatrix(std::size_t nFeatures) : nFeatures_(nFeatures) {}
+    FeatureMatrix(std::size_t nRows, std::size_t nFeatures);
+    //Read-only columns that live elsewhere, such as a mapped cache file. owner is held for as long as the matrix
+    //uses them. stride must keep every column 64 byte aligned. Growing the matrix copies it into owned storage
+    static FeatureMatrix borrow(const double* data, std::size_t nRows, std::size_t nFeatures, std::size_t stride,
+                                std::shared_ptr<const void> owner);
+
+    std::size_t rows() const { return nRows_; }
+    std::size_t features() const { return nFeatures_; }
+    std::size_t stride() const { return stride_; }
+
+    bool borrowed() const { return owner_ != nullptr; }
+    const double* column(std::size_t feature) const { return base_ + feature * stride_; }
+    //Writable column, borrowed columns are read-only
+    double* column(std::size_t feature) {
+        if (owner_) {
+            throw std::logic_error("Borrowed feature columns are read-only");
+        }
+        return base_ + feature * stride_;
+    }
+    double at(std::size_t row, std::size_t feature) const { return column(feature)[row]; }
+
+    void reserve(std::size_t nRows);
+    //Sets the row count, values of new rows are unset until written
+    void resize(std::size_t nRows);
+    //Appends one sample, values must hold features() doubles
+    void appendRow(const double* values);
+};
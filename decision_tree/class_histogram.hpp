@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "dataset/dataset.hpp"
+#include "dataset/feature_bins.hpp"
+#include "thread_pool/thread_pool.hpp"
+
+//Per feature, per bin, per class sample counts of one node
+class ClassHistogram {
+private:
+    int nClasses_ = 0;
+    int nSamples_ = 0;
+    //counts_[(bins.binOffset(feature) + bin) * nClasses_ + classId]
+    std::vector<int> counts_;
+
+public:
+    ClassHistogram() = default;
+
+    //One pass over the samples, reads only the byte codes and class ids. Features are filled in parallel when given a pool
+    template <typename Indices>
+    void build(const FeatureBins& bins, const Dataset& dataset, const Indices& samples, ThreadPool* pool = nullptr) {
+        nClasses_ = dataset.totalClasses();
+        nSamples_ = static_cast<int>(samples.size());
+        counts_.assign(bins.totalBins() * nClasses_, 0);
+        ArrayView<std::uint16_t> classIds = dataset.getClassIds();
+        auto buildFeature = [&](std::size_t f) {
+            const std::uint8_t* codes = bins.getCodeColumn(static_cast<int>(f));
+            int* featureCounts = counts_.data() + bins.binOffset(static_cast<int>(f)) * nClasses_;
+            for (auto row : samples) {
+                featureCounts[codes[row] * nClasses_ + classIds[row]]++;
+            }
+        };
+        if (pool != nullptr) {
+            pool->parallelFor(bins.features(), buildFeature);
+            return;
+        }
+        for (int f = 0; f < bins.features(); f++) {
+            buildFeature(f);
+        }
+    }
+    //Histogram subtraction, a child's histogram is its parent's minus its sibling's
+    void subtract(const ClassHistogram& parent, const ClassHistogram& sibling) {
+        nClasses_ = parent.nClasses_;
+        nSamples_ = parent.nSamples_ - sibling.nSamples_;
+        counts_.resize(parent.counts_.size());
+        for (std::size_t i = 0; i < counts_.size(); i++) {
+            counts_[i] = parent.counts_[i] - sibling.counts_[i];
+        }
+    }
+    void clear() {
+        nSamples_ = 0;
+        std::vector<int>().swap(counts_);
+    }
+
+    bool empty() const { return counts_.empty(); }
+    int getNumberSamples() const { return nSamples_; }
+    int getNumberClasses() const { return nClasses_; }
+    const int* binCounts(const FeatureBins& bins, int feature, int bin) const {
+        return counts_.data() + (bins.binOffset(feature) + bin) * nClasses_;
+    }
+};
@@ -0,0 +1,140 @@
+#include "compiled_tree.hpp"
+#include "simd_traversal.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+CompiledTree::CompiledTree(const Node& root, int nFeatures, int nClasses, LeafOutput output)
+    : nClasses_(nClasses), nFeatures_(nFeatures) {
+    if (output == LeafOutput::Value && nClasses != 1) {
+        throw std::runtime_error("A tree of leaf values has exactly one output");
+    }
+    //Breadth-first, so the two children of a node are always next to each other
+    std::vector<const Node*> order = {&root};
+    std::vector<std::uint32_t> depths = {0};
+    for (std::size_t i = 0; i < order.size(); i++) {
+        const Node* node = order[i];
+        if (order.size() > std::numeric_limits<std::uint32_t>::max() - 2) {
+            throw std::runtime_error("Tree has too many nodes to compile");
+        }
+        std::uint32_t index = static_cast<std::uint32_t>(i);
+        depth_ = std::max(depth_, depths[i]);
+        classIds_.push_back(node->getPredictedClass());
+        if (node->getIsLeaf()) {
+            nodes_.push_back({std::numeric_limits<double>::quiet_NaN(), 0, index});
+            leafIndices_.push_back(leafCount_++);
+            if (output == LeafOutput::Value) {
+                probabilities_.push_back(node->getValue());
+                continue;
+            }
+            const std::vector<int>& counts = node->getPredictionCounts();
+            int total = 0;
+            for (int count : counts) {
+                total += count;
+            }
+            for (int c = 0; c < nClasses; c++) {
+                probabilities_.push_back((c < static_cast<int>(counts.size()) && total > 0) ? (double)counts[c] / total : 0.0);
+            }
+            continue;
+        }
+        nodes_.push_back({node->getClassifierValue(), node->getFeatureIndex(), static_cast<std::uint32_t>(order.size())});
+        leafIndices_.push_back(0);
+        order.push_back(node->getLeftChild());
+        order.push_back(node->getRightChild());
+        depths.push_back(depths[i] + 1);
+        depths.push_back(depths[i] + 1);
+    }
+}
+
+CompiledTree::CompiledTree(std::vector<FlatNode> nodes, std::vector<std::uint16_t> classIds, std::vector<std::uint32_t> leafIndices,
+                           std::vector<double> probabilities, int nFeatures, int nClasses)
+    : nodes_(std::move(nodes)), classIds_(std::move(classIds)), leafIndices_(std::move(leafIndices)),
+      probabilities_(std::move(probabilities)), nClasses_(nClasses), nFeatures_(nFeatures) {
+    if (nodes_.empty() || classIds_.size() != nodes_.size() || leafIndices_.size() != nodes_.size() || nClasses <= 0 ||
+        probabilities_.size() % nClasses != 0 || nodes_.size() > std::numeric_limits<std::uint32_t>::max() - 2) {
+        throw std::runtime_error("Compiled tree arrays do not fit together");
+    }
+    leafCount_ = static_cast<std::uint32_t>(probabilities_.size() / nClasses);
+    //Children always come after their parent, so one forward pass settles every depth
+    std::vector<std::uint32_t> depths(nodes_.size(), 0);
+    for (std::uint32_t i = 0; i < nodes_.size(); i++) {
+        std::uint32_t child = nodes_[i].child;
+        if (child == i) {
+            if (leafIndices_[i] >= leafCount_) {
+                throw std::runtime_error("Compiled tree leaf " + std::to_string(i) + " has no probabilities");
+            }
+            continue;
+        }
+        if (child <= i || child + 1 >= nodes_.size()) {
+            throw std::runtime_error("Compiled tree node " + std::to_string(i) + " is not in breadth-first order");
+        }
+        depths[child] = depths[child + 1] = depths[i] + 1;
+        depth_ = std::max(depth_, depths[child]);
+    }
+}
+
+CompiledTreeView CompiledTree::view() const {
+    CompiledTreeView view;
+    view.nodes = nodes_.data();
+    view.classIds = classIds_.data();
+    view.leafIndices = leafIndices_.data();
+    view.probabilities = probabilities_.data();
+    view.nodeCount = static_cast<std::uint32_t>(nodes_.size());
+    view.leafCount = leafCount_;
+    view.nClasses = nClasses_;
+    view.nFeatures = nFeatures_;
+    view.depth = depth_;
+    return view;
+}
+
+void CompiledTreeView::predictProbabilities(const double* row, double* out, std::size_t stride) const {
+    const double* leaf = probabilities + static_cast<std::size_t>(leafIndices[findLeaf(row, stride)]) * nClasses;
+    std::copy(leaf, leaf + nClasses, out);
+}
+
+void CompiledTreeView::predictRange(const double* data, std::size_t nRows, FeatureLayout layout, std::size_t begin, std::size_t end, std::uint16_t* out) const {
+    predictRangeSimd(*this, data, nRows, layout, begin, end, out);
+}
+
+void CompiledTreeView::predictBatch(const double* data, std::size_t nRows, FeatureLayout layout, std::uint16_t* out) const {
+    predictRange(data, nRows, layout, 0, nRows, out);
+}
+
+void CompiledTreeView::predictProbabilitiesBatch(const double* data, std::size_t nRows, FeatureLayout layout, double* out) const {
+    std::size_t stride = featureStride(layout, nRows);
+    for (std::size_t row = 0; row < nRows; row++) {
+        predictProbabilities(data + rowOffset(layout, row, nFeatures), out + row * nClasses, stride);
+    }
+}
+
+void CompiledTree::predictBatch(const double* data, std::size_t nRows, FeatureLayout layout, std::uint16_t* out, ThreadPool* pool) const {
+    CompiledTreeView tree = view();
+    if (pool == nullptr) {
+        tree.predictBatch(data, nRows, layout, out);
+        return;
+    }
+    std::size_t nBlocks = (nRows + kBlockRows - 1) / kBlockRows;
+    pool->parallelFor(nBlocks, [&](std::size_t block) {
+        std::size_t begin = block * kBlockRows;
+        tree.predictRange(data, nRows, layout, begin, std::min(nRows, begin + kBlockRows), out);
+    });
+}
+
+void CompiledTree::predictProbabilitiesBatch(const double* data, std::size_t nRows, FeatureLayout layout, double* out, ThreadPool* pool) const {
+    CompiledTreeView tree = view();
+    if (pool == nullptr) {
+        tree.predictProbabilitiesBatch(data, nRows, layout, out);
+        return;
+    }
+    std::size_t stride = featureStride(layout, nRows);
+    std::size_t nBlocks = (nRows + kBlockRows - 1) / kBlockRows;
+    pool->parallelFor(nBlocks, [&](std::size_t block) {
+        std::size_t begin = block * kBlockRows;
+        std::size_t end = std::min(nRows, begin + kBlockRows);
+        for (std::size_t row = begin; row < end; row++) {
+            tree.predictProbabilities(data + rowOffset(layout, row, nFeatures_), out + row * nClasses_, stride);
+        }
+    });
+}
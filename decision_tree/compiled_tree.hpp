@@ -0,0 +1,102 @@
+//Immutable inference form of a trained tree: every node in one contiguous breadth-first buffer
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "feature_layout.hpp"
+#include "node.hpp"
+#include "thread_pool/thread_pool.hpp"
+
+//16 bytes, four nodes per cache line
+struct FlatNode {
+    //Rows with input >= threshold go right. NaN for leaves, so the comparison is always false
+    double threshold;
+    //0 for leaves, which keeps the feature read in bounds for branchless walks
+    std::int32_t feature;
+    //Left child index, the right child sits at child + 1. A leaf points at itself
+    std::uint32_t child;
+};
+static_assert(sizeof(FlatNode) == 16, "FlatNode should stay 16 bytes");
+
+//What a compiled leaf keeps in its row of probabilities
+enum class LeafOutput {
+    //nClasses shares from the training class counts
+    ClassProbabilities,
+    //Node::getValue as a single entry, for boosted trees
+    Value,
+};
+
+//Non-owning look at compiled tree memory, it can point into a CompiledTree or a mapped model file
+struct CompiledTreeView {
+    const FlatNode* nodes = nullptr;
+    //Majority class of every node
+    const std::uint16_t* classIds = nullptr;
+    //Leaf number of every node, rows of probabilities are indexed by it (internal nodes hold 0)
+    const std::uint32_t* leafIndices = nullptr;
+    //leafCount * nClasses class probabilities
+    const double* probabilities = nullptr;
+    std::uint32_t nodeCount = 0;
+    std::uint32_t leafCount = 0;
+    std::uint32_t nClasses = 0;
+    std::uint32_t nFeatures = 0;
+    //Edges on the longest root to leaf path
+    std::uint32_t depth = 0;
+
+    bool isLeaf(std::uint32_t index) const { return nodes[index].child == index; }
+    //Index of the leaf a row ends on, feature f of the row is row[f * stride]
+    std::uint32_t findLeaf(const double* row, std::size_t stride = 1) const {
+        std::uint32_t index = 0;
+        while (!isLeaf(index)) {
+            const FlatNode& node = nodes[index];
+            index = node.child + (row[node.feature * stride] >= node.threshold ? 1 : 0);
+        }
+        return index;
+    }
+    std::uint16_t predict(const double* row, std::size_t stride = 1) const { return classIds[findLeaf(row, stride)]; }
+    //First entry of the leaf's row, the output of a LeafOutput::Value tree
+    double predictValue(const double* row, std::size_t stride = 1) const {
+        return probabilities[static_cast<std::size_t>(leafIndices[findLeaf(row, stride)]) * nClasses];
+    }
+    //Writes nClasses probabilities to out
+    void predictProbabilities(const double* row, double* out, std::size_t stride = 1) const;
+    //Serial batch versions, CompiledTree adds the threaded ones
+    void predictBatch(const double* data, std::size_t nRows, FeatureLayout layout, std::uint16_t* out) const;
+    void predictProbabilitiesBatch(const double* data, std::size_t nRows, FeatureLayout layout, double* out) const;
+    //Rows [begin, end) of a batch, on the widest SIMD kernel the CPU has
+    void predictRange(const double* data, std::size_t nRows, FeatureLayout layout, std::size_t begin, std::size_t end, std::uint16_t* out) const;
+};
+
+class CompiledTree {
+private:
+    std::vector<FlatNode> nodes_;
+    std::vector<std::uint16_t> classIds_;
+    std::vector<std::uint32_t> leafIndices_;
+    std::vector<double> probabilities_;
+    std::uint32_t leafCount_ = 0;
+    std::uint32_t nClasses_ = 0;
+    std::uint32_t nFeatures_ = 0;
+    std::uint32_t depth_ = 0;
+    //Rows handed to one pool task by the batch predictors
+    static constexpr std::size_t kBlockRows = 4096;
+
+public:
+    CompiledTree() = default;
+    //Flattens the tree below root, leaves take their class and probabilities from the training counts.
+    //LeafOutput::Value keeps each leaf's value instead and needs nClasses 1
+    CompiledTree(const Node& root, int nFeatures, int nClasses, LeafOutput output = LeafOutput::ClassProbabilities);
+    //Takes arrays already in the breadth-first layout, for trainers that do not build Nodes.
+    //probabilities holds nClasses values per leaf
+    CompiledTree(std::vector<FlatNode> nodes, std::vector<std::uint16_t> classIds, std::vector<std::uint32_t> leafIndices,
+                 std::vector<double> probabilities, int nFeatures, int nClasses);
+
+    CompiledTreeView view() const;
+    std::size_t nodeCount() const { return nodes_.size(); }
+    std::uint32_t depth() const { return depth_; }
+
+    std::uint16_t predict(const double* row, std::size_t stride = 1) const { return view().predict(row, stride); }
+    void predictProbabilities(const double* row, double* out, std::size_t stride = 1) const { view().predictProbabilities(row, out, stride); }
+    double predictValue(const double* row, std::size_t stride = 1) const { return view().predictValue(row, stride); }
+    //Blocks of rows are spread over the pool when one is given
+    void predictBatch(const double* data, std::size_t nRows, FeatureLayout layout, std::uint16_t* out, ThreadPool* pool = nullptr) const;
+    void predictProbabilitiesBatch(const double* data, std::size_t nRows, FeatureLayout layout, double* out, ThreadPool* pool = nullptr) const;
+};
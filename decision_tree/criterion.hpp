@@ -0,0 +1,38 @@
+//Impurity criteria for classification splits, passed as template policies so every scan is compiled for one of them.
+//A criterion scores a node as impurity(termSum, total), termSum adding up term(count) over the node's class counts,
+//and a split as the sample weighted impurity of its children. Being a sum over classes, moving one sample across a
+//split changes one term per side, so the sorted scan updates both sides in O(1) whatever the criterion.
+//A custom criterion is any type with these two static functions
+#pragma once
+#include <cmath>
+
+//1 - sum(c^2) / n^2
+struct GiniCriterion {
+    static double term(double count) { return count * count; }
+    static double impurity(double termSum, double total) { return 1.0 - termSum / (total * total); }
+};
+
+//Shannon entropy in bits, log2(n) - sum(c log2 c) / n
+struct EntropyCriterion {
+    static double term(double count) { return count > 0 ? count * std::log2(count) : 0.0; }
+    static double impurity(double termSum, double total) { return std::log2(total) - termSum / total; }
+};
+
+//Mean log-loss of predicting the node's class shares, the entropy in nats
+struct LogLossCriterion {
+    static double term(double count) { return count > 0 ? count * std::log(count) : 0.0; }
+    static double impurity(double termSum, double total) { return std::log(total) - termSum / total; }
+};
+
+//Impurity of a node holding counts[c] samples of class c, total in all
+template <typename Criterion, typename Count>
+double classImpurity(const Count* counts, int nClasses, Count total) {
+    if (total == 0) {
+        return 0.0;
+    }
+    double termSum = 0.0;
+    for (int c = 0; c < nClasses; c++) {
+        termSum += Criterion::term(static_cast<double>(counts[c]));
+    }
+    return Criterion::impurity(termSum, static_cast<double>(total));
+}
@@ -1,33 +1,114 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <stdexcept>
 #include "../dataset/dataset.hpp"
+#include "../dataset/feature_bins.hpp"
+#include "./criterion.hpp"
 #include "./node.hpp"
+#include "./compiled_tree.hpp"
+#include "./feature_layout.hpp"
+#include "./model_file.hpp"
+#include "../thread_pool/thread_pool.hpp"
 
-class DecisionTree {
+enum class SplitMethod {
+    //Every midpoint between neighbouring sorted values
+    Exact,
+    //Only the edges of at most 256 quantile bins per feature
+    Histogram,
+};
+
+enum class GrowthPolicy {
+    //All leaves of one depth before any deeper one
+    LevelWise,
+    //Always the leaf whose split lowers impurity the most, best used with maxLeaves
+    BestFirst,
+};
+
+//Limits for DecisionTree::train, a leaf is only split while all of them allow it
+struct TrainOptions {
+    GrowthPolicy growth = GrowthPolicy::LevelWise;
+    //Edges from the root to the deepest leaf
+    int maxDepth = 10;
+    //Samples each child of a split must keep
+    int minSamplesLeaf = 1;
+    //Smallest accepted drop in impurity, weighted by the node's share of the dataset:
+    //nSamples / totalSamples * (impurity - weighted child impurity)
+    double minImpurityDecrease = 0.0;
+    //Leaves the finished tree may have, 0 for no limit
+    int maxLeaves = 0;
+    //Features tried per split, drawn afresh for every node. 0 tries them all
+    int maxFeatures = 0;
+    //Seeds the feature draws, the same seed and options give the same tree
+    std::uint64_t seed = 0;
+};
+
+//Criterion scores classification splits, see criterion.hpp. Every split search is compiled for it
+template <typename Criterion = GiniCriterion>
+class BasicDecisionTree {
 
 private:
-    std::unique_ptr<Node> head_;
-    Dataset dataset_;
-    static int totalNodes_;
-    static int getNextId() {
-        totalNodes_ += 1;
-        return totalNodes_;
-    }
+    //Behind a pointer so the nodes' arena stays put when the tree is moved
+    std::unique_ptr<NodeArena> nodes_ = std::make_unique<NodeArena>();
+    Node* head_ = nullptr;
+    //Read-only once the tree exists, so any number of trees can train on one copy
+    std::shared_ptr<const Dataset> dataset_;
+    SplitMethod splitMethod_ = SplitMethod::Exact;
+    int maxBins_ = FeatureBins::kMaxBins;
+    //Quantized once on the first histogram split
+    std::shared_ptr<const FeatureBins> bins_;
+    //Null means train on the calling thread only
+    std::unique_ptr<ThreadPool> pool_;
+    //Draws the per-split feature subsets of train
+    std::mt19937_64 featureRandom_;
   
 public:
 
-    explicit DecisionTree() { makeHeadNode(); }   
-    static int getTotalNodes() {
-        return totalNodes_;
+    explicit BasicDecisionTree() : dataset_(std::make_shared<const Dataset>()) { makeHeadNode(); }   
+    explicit BasicDecisionTree(Dataset dataset) : dataset_(std::make_shared<const Dataset>(std::move(dataset))) { makeHeadNode(); }
+    explicit BasicDecisionTree(std::shared_ptr<const Dataset> dataset) : dataset_(std::move(dataset)) { makeHeadNode(); }
+    //Nodes of the current tree, their ids run from 0 to this
+    int getTotalNodes() const {
+        return static_cast<int>(nodes_->size());
+    }
+    const Node* getHeadNode() const { return head_; }
+    Node* getHeadNode() { return head_; }
+    const Dataset& getDataset() const { return *dataset_; }
+    const std::shared_ptr<const Dataset>& getSharedDataset() const { return dataset_; }
+    int getThreadCount() const { return pool_ ? pool_->size() : 1; }
+    //Threads used by makeSplits, 0 picks the hardware concurrency. Any count gives the same tree
+    void setThreadCount(int nThreads) {
+        if (nThreads == 1) {
+            pool_.reset();
+            return;
+        }
+        pool_ = std::make_unique<ThreadPool>(nThreads);
+        if (pool_->size() == 1) {
+            pool_.reset();
+        }
+    }
+    SplitMethod getSplitMethod() const { return splitMethod_; }
+    //Histogram splits on bins built elsewhere from the same dataset, so several trees can share one copy
+    void setBins(std::shared_ptr<const FeatureBins> bins) {
+        splitMethod_ = SplitMethod::Histogram;
+        bins_ = std::move(bins);
+    }
+    void setSplitMethod(SplitMethod method, int maxBins = FeatureBins::kMaxBins) {
+        splitMethod_ = method;
+        if (maxBins != maxBins_) {
+            bins_.reset();
+        }
+        maxBins_ = maxBins;
     }
-    const Node* getHeadNode() const { return head_.get(); }
-    Node* getHeadNode() { return head_.get(); }
-    const Dataset& getDataset() const { return dataset_; }
 
-    void runTree(DataContainer& input) { head_->runInput(input); }
+    void runTree(std::size_t row) { head_->runInput(*dataset_, row); }
     double calculateAllImpurity() {
-        return head_->calculateImpurityForward();
+        return head_->calculateImpurityForward<Criterion>();
         
     }
     
@@ -35,28 +116,329 @@ public:
         head_->resetNodeRecursive();
 
     }
+    //Drops the whole tree in O(1), its nodes' storage is reused by the new one
     void makeHeadNode() {
-        head_ = std::make_unique<Node>(Node());
+        nodes_->clear();
+        head_ = nodes_->create();
     }
 
     //Runs the tree oiver the dataset
     void runTree() {
         resetTree();
-        for (int i = 0; i < dataset_.totalContainers(); i++) {
-            head_->runInput(dataset_.getContainer(i));
+        DT_PROFILE_SCOPE(Route);
+        for (int i = 0; i < dataset_->totalContainers(); i++) {
+            head_->runInput(*dataset_, i);
         }
     }
 
+    //Prediction uses the class counts each leaf had when makeSplits last saw it. None of these copy,
+    //allocate or write to the tree, so they can be called from any number of threads at once
+
+    //Majority class id of the leaf the row lands in, features[f] is feature f
+    std::uint16_t predict(const double* features) const {
+        return head_->findLeaf(features)->getPredictedClass();
+    }
+    //Mean training target of the leaf the row lands in, for regression datasets
+    double predictValue(const double* features) const {
+        return head_->findLeaf(features)->getValue();
+    }
+    //Writes dataset.totalClasses() class probabilities to out
+    void predictProbabilities(const double* features, double* out) const {
+        writeProbabilities(head_->findLeaf(features), out);
+    }
+    //One class id per row into out
+    void predictBatch(const double* data, std::size_t nRows, FeatureLayout layout, std::uint16_t* out) const {
+        forEachBlock(nRows, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t row = begin; row < end; row++) {
+                out[row] = findLeaf(data, nRows, layout, row)->getPredictedClass();
+            }
+        });
+    }
+    //nRows * totalClasses() probabilities into out, row-major
+    void predictProbabilitiesBatch(const double* data, std::size_t nRows, FeatureLayout layout, double* out) const {
+        std::size_t nClasses = dataset_->totalClasses();
+        forEachBlock(nRows, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t row = begin; row < end; row++) {
+                writeProbabilities(findLeaf(data, nRows, layout, row), out + row * nClasses);
+            }
+        });
+    }
+
+    //Grows a fresh tree. Every node is scanned once and hands its samples to its children when it splits,
+    //so the dataset is routed from the root only once instead of once per level.
+    //Level-wise growth splits each level left to right, which is also the order maxLeaves cuts them off in.
+    //Best-first growth keeps the scanned leaves in a max-heap on their impurity decrease and always splits
+    //the top one, so a maxLeaves budget goes to the splits that help most. Returns the number of leaves
+    int train(const TrainOptions& options = {}) {
+        startTraining(options);
+        runTree();
+        return grow(options);
+    }
+    //Same on a sample of the rows, a row listed twice counts twice, as in a bootstrap sample
+    int train(const TrainOptions& options, const std::vector<std::uint32_t>& rows) {
+        startTraining(options);
+        {
+            DT_PROFILE_SCOPE(Route);
+            for (std::uint32_t row : rows) {
+                head_->runInput(*dataset_, row);
+            }
+        }
+        return grow(options);
+    }
+
+    //Flat, pointer-free copy of the current tree for inference, later training does not affect it.
+    //A regression tree keeps its leaf means, read them with CompiledTree::predictValue
+    CompiledTree compile() const {
+        if (dataset_->isRegression()) {
+            return CompiledTree(*head_, dataset_->totalFeatures(), 1, LeafOutput::Value);
+        }
+        return CompiledTree(*head_, dataset_->totalFeatures(), dataset_->totalClasses());
+    }
+    //Compiles the current tree and writes it as a model file, load it back with MappedModel. Model files name
+    //their classes, so they hold classification trees only
+    void save(const std::string& path) const {
+        if (dataset_->isRegression()) {
+            throw std::runtime_error("Model files hold classification trees, this one is a regression");
+        }
+        writeModelFile(path, compile().view(), dataset_->getClassNames());
+    }
+
     //Recursive split
     void makeSplits() {
-        this->head_->optimizeNode(dataset_);
-        //Todo: Finish
-        
-        
+        if (splitMethod_ == SplitMethod::Histogram && !bins_) {
+            bins_ = std::make_shared<const FeatureBins>(*dataset_, maxBins_);
+        }
+        if (pool_) {
+            makeSplitsParallel();
+        } else if (splitMethod_ == SplitMethod::Histogram) {
+            this->head_->optimizeNodeHistogram<Criterion>(*dataset_, *bins_);
+        } else {
+            this->head_->optimizeNode<Criterion>(*dataset_);
+        }
     }
 
     //Runs an iteration of the training loop, calculates aggregate impurity before and ater 
 
+private:
+    //Rows handed to one pool task by the batch predictors
+    static constexpr std::size_t kPredictBlockRows = 4096;
 
+    const Node* findLeaf(const double* data, std::size_t nRows, FeatureLayout layout, std::size_t row) const {
+        return head_->findLeaf(data + rowOffset(layout, row, dataset_->totalFeatures()), featureStride(layout, nRows));
+    }
+    void writeProbabilities(const Node* leaf, double* out) const {
+        const std::vector<int>& counts = leaf->getPredictionCounts();
+        int total = 0;
+        for (int count : counts) {
+            total += count;
+        }
+        for (int c = 0; c < dataset_->totalClasses(); c++) {
+            out[c] = (c < static_cast<int>(counts.size()) && total > 0) ? (double)counts[c] / total : 0.0;
+        }
+    }
+    template <typename Body>
+    void forEachBlock(std::size_t nRows, const Body& body) const {
+        std::size_t nBlocks = (nRows + kPredictBlockRows - 1) / kPredictBlockRows;
+        auto runBlock = [&](std::size_t block) {
+            std::size_t begin = block * kPredictBlockRows;
+            body(begin, std::min(nRows, begin + kPredictBlockRows));
+        };
+        if (pool_) {
+            pool_->parallelFor(nBlocks, runBlock);
+            return;
+        }
+        for (std::size_t block = 0; block < nBlocks; block++) {
+            runBlock(block);
+        }
+    }
+    void startTraining(const TrainOptions& options) {
+        if (splitMethod_ == SplitMethod::Histogram && !bins_) {
+            bins_ = std::make_shared<const FeatureBins>(*dataset_, maxBins_);
+        }
+        featureRandom_.seed(options.seed);
+        makeHeadNode();
+    }
+    int grow(const TrainOptions& options) {
+        head_->capturePrediction();
+        return options.growth == GrowthPolicy::BestFirst ? trainBestFirst(options) : trainLevelWise(options);
+    }
+    //maxFeatures distinct features in ascending order, a partial Fisher-Yates shuffle
+    std::vector<int> drawFeatures(int maxFeatures) {
+        std::vector<int> features(dataset_->totalFeatures());
+        std::iota(features.begin(), features.end(), 0);
+        for (int i = 0; i < maxFeatures; i++) {
+            std::uniform_int_distribution<int> pick(i, static_cast<int>(features.size()) - 1);
+            std::swap(features[i], features[pick(featureRandom_)]);
+        }
+        features.resize(maxFeatures);
+        std::sort(features.begin(), features.end());
+        return features;
+    }
+    //Drop in impurity a split brings, weighted by the node's share of the training samples
+    double impurityDecrease(Node* node, const SplitCandidate& split) {
+        return (double)node->getNumberSamples() / head_->getNumberSamples() * (node->getImpurity<Criterion>() - split.impurity);
+    }
+    bool acceptSplit(Node* node, const SplitCandidate& split, const TrainOptions& options, int leaves) {
+        return split.found && impurityDecrease(node, split) >= options.minImpurityDecrease &&
+               (options.maxLeaves <= 0 || leaves < options.maxLeaves);
+    }
+    //Split children are scanned next, so histograms are made from the parent's while it still has one
+    void handDown(Node* node, bool scanChildren) {
+        if (scanChildren && splitMethod_ == SplitMethod::Histogram) {
+            node->prepareChildHistograms(*dataset_, *bins_);
+        }
+        node->releaseSamples();
+    }
+    int trainLevelWise(const TrainOptions& options) {
+        int leaves = 1;
+        std::vector<Node*> level = {head_};
+        for (int depth = 0; depth < options.maxDepth && !level.empty(); depth++) {
+            std::vector<SplitCandidate> best = findLevelSplits(level, options);
+            std::vector<Node*> split;
+            std::vector<Node*> next;
+            for (std::size_t i = 0; i < level.size(); i++) {
+                Node* node = level[i];
+                if (!acceptSplit(node, best[i], options, leaves)) {
+                    node->releaseSamples();
+                    continue;
+                }
+                node->applySplit<Criterion>(*dataset_, best[i], pool_.get());
+                DT_PROFILE_SPLIT_AT(depth);
+                leaves++;
+                split.push_back(node);
+                next.push_back(node->getLeftChild());
+                next.push_back(node->getRightChild());
+            }
+            bool scanNext = depth + 1 < options.maxDepth;
+            forEachNode(split.size(), [&](std::size_t i) { handDown(split[i], scanNext); });
+            level = std::move(next);
+        }
+        for (Node* leaf : level) {
+            leaf->releaseSamples();
+        }
+        return leaves;
+    }
+    int trainBestFirst(const TrainOptions& options) {
+        struct Candidate {
+            double decrease;
+            //Scan order, breaks ties in favour of the older leaf so growth stays deterministic
+            std::size_t order;
+            Node* node;
+            int depth;
+            SplitCandidate split;
+            bool operator<(const Candidate& other) const {
+                return decrease != other.decrease ? decrease < other.decrease : order > other.order;
+            }
+        };
+        std::priority_queue<Candidate> heap;
+        std::size_t scanned = 0;
+        //Scans the leaves and queues the ones worth splitting, the rest are final
+        auto push = [&](const std::vector<Node*>& nodes, int depth) {
+            if (depth >= options.maxDepth) {
+                for (Node* node : nodes) {
+                    node->releaseSamples();
+                }
+                return;
+            }
+            std::vector<SplitCandidate> best = findLevelSplits(nodes, options);
+            for (std::size_t i = 0; i < nodes.size(); i++) {
+                if (best[i].found && impurityDecrease(nodes[i], best[i]) >= options.minImpurityDecrease) {
+                    heap.push({impurityDecrease(nodes[i], best[i]), scanned++, nodes[i], depth, best[i]});
+                } else {
+                    nodes[i]->releaseSamples();
+                }
+            }
+        };
+        int leaves = 1;
+        push({head_}, 0);
+        while (!heap.empty() && (options.maxLeaves <= 0 || leaves < options.maxLeaves)) {
+            Candidate top = heap.top();
+            heap.pop();
+            top.node->template applySplit<Criterion>(*dataset_, top.split, pool_.get());
+            DT_PROFILE_SPLIT_AT(top.depth);
+            leaves++;
+            handDown(top.node, top.depth + 1 < options.maxDepth);
+            push({top.node->getLeftChild(), top.node->getRightChild()}, top.depth + 1);
+        }
+        //Leaves the budget ran out on
+        for (; !heap.empty(); heap.pop()) {
+            heap.top().node->releaseSamples();
+        }
+        return leaves;
+    }
+    template <typename Body>
+    void forEachNode(std::size_t n, const Body& body) {
+        if (pool_) {
+            pool_->parallelFor(n, body);
+            return;
+        }
+        for (std::size_t i = 0; i < n; i++) {
+            body(i);
+        }
+    }
+    //Best split of every node in level. Nodes are searched concurrently, or their features are when the level
+    //is narrower than the pool. Feature subsets are drawn up front in level order, so the result is the same either way
+    std::vector<SplitCandidate> findLevelSplits(const std::vector<Node*>& level, const TrainOptions& options) {
+        bool histogram = splitMethod_ == SplitMethod::Histogram;
+        bool subsets = options.maxFeatures > 0 && options.maxFeatures < dataset_->totalFeatures();
+        std::vector<std::vector<int>> features(subsets ? level.size() : 0);
+        for (std::vector<int>& drawn : features) {
+            drawn = drawFeatures(options.maxFeatures);
+        }
+        int minSamplesLeaf = options.minSamplesLeaf;
+        bool perNode = pool_ && level.size() >= static_cast<std::size_t>(pool_->size());
+        ThreadPool* featurePool = perNode ? nullptr : pool_.get();
+        std::vector<SplitCandidate> best(level.size());
+        auto evaluate = [&](std::size_t i) {
+            const std::vector<int>* drawn = subsets ? &features[i] : nullptr;
+            best[i] = histogram ? level[i]->findBestSplitHistogram<Criterion>(*dataset_, *bins_, featurePool, minSamplesLeaf, drawn)
+                                : level[i]->findBestSplit<Criterion>(*dataset_, featurePool, minSamplesLeaf, drawn);
+        };
+        if (perNode) {
+            pool_->parallelFor(level.size(), evaluate);
+        } else {
+            for (std::size_t i = 0; i < level.size(); i++) {
+                evaluate(i);
+            }
+        }
+        return best;
+    }
+    //Same splits as the recursive optimizeNode. Leaves are searched concurrently, or their features are
+    //when the frontier is narrower than the pool, then the splits are applied in tree order so node ids match too
+    void makeSplitsParallel() {
+        bool histogram = splitMethod_ == SplitMethod::Histogram;
+        std::vector<Node*> leaves;
+        std::vector<Node*> internals;
+        head_->collectLeaves(leaves, &internals);
+        if (histogram) {
+            pool_->parallelFor(internals.size(), [&](std::size_t i) {
+                internals[i]->prepareChildHistograms(*dataset_, *bins_);
+            });
+        }
+
+        bool perLeaf = leaves.size() >= static_cast<std::size_t>(pool_->size());
+        ThreadPool* featurePool = perLeaf ? nullptr : pool_.get();
+        std::vector<SplitCandidate> best(leaves.size());
+        auto evaluate = [&](std::size_t i) {
+            best[i] = histogram ? leaves[i]->findBestSplitHistogram<Criterion>(*dataset_, *bins_, featurePool)
+                                : leaves[i]->findBestSplit<Criterion>(*dataset_, featurePool);
+        };
+        if (perLeaf) {
+            pool_->parallelFor(leaves.size(), evaluate);
+        } else {
+            for (std::size_t i = 0; i < leaves.size(); i++) {
+                evaluate(i);
+            }
+        }
+
+        for (std::size_t i = 0; i < leaves.size(); i++) {
+            if (best[i].found) {
+                leaves[i]->applySplit<Criterion>(*dataset_, best[i], pool_.get());
+            }
+        }
+    }
 
 };
+
+//The Gini tree everything else uses
+using DecisionTree = BasicDecisionTree<GiniCriterion>;
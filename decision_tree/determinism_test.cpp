@@ -0,0 +1,61 @@
+#include <cstring>
+#include <memory>
+#include <gtest/gtest.h>
+#include "decision_tree.hpp"
+
+namespace {
+
+//Trees of every thread count must match bit for bit, thresholds and NaN leaves included
+constexpr int kThreads = 4;
+
+std::shared_ptr<const Dataset> loadIris() {
+    static const std::shared_ptr<const Dataset> iris = std::make_shared<const Dataset>("data/iris.data", 4);
+    return iris;
+}
+
+CompiledTree trainIris(SplitMethod method, GrowthPolicy growth, int nThreads) {
+    DecisionTree tree(loadIris());
+    tree.setSplitMethod(method, method == SplitMethod::Histogram ? 16 : FeatureBins::kMaxBins);
+    tree.setThreadCount(nThreads);
+    TrainOptions options;
+    options.growth = growth;
+    options.maxDepth = 8;
+    tree.train(options);
+    return tree.compile();
+}
+
+void expectSameNodes(const CompiledTree& expected, const CompiledTree& actual) {
+    CompiledTreeView a = expected.view();
+    CompiledTreeView b = actual.view();
+    ASSERT_EQ(a.nodeCount, b.nodeCount);
+    ASSERT_EQ(a.leafCount, b.leafCount);
+    EXPECT_EQ(a.depth, b.depth);
+    EXPECT_EQ(std::memcmp(a.nodes, b.nodes, a.nodeCount * sizeof(FlatNode)), 0);
+    EXPECT_EQ(std::memcmp(a.probabilities, b.probabilities, std::size_t(a.leafCount) * a.nClasses * sizeof(double)), 0);
+}
+
+struct DeterminismCase {
+    SplitMethod method;
+    GrowthPolicy growth;
+};
+
+class DeterminismTest : public ::testing::TestWithParam<DeterminismCase> {};
+
+TEST_P(DeterminismTest, ThreadCountDoesNotChangeTheTree) {
+    CompiledTree serial = trainIris(GetParam().method, GetParam().growth, 1);
+    ASSERT_GT(serial.nodeCount(), 1u);
+    expectSameNodes(serial, trainIris(GetParam().method, GetParam().growth, kThreads));
+}
+
+TEST_P(DeterminismTest, RetrainingGivesTheSameTree) {
+    expectSameNodes(trainIris(GetParam().method, GetParam().growth, kThreads),
+                    trainIris(GetParam().method, GetParam().growth, kThreads));
+}
+
+INSTANTIATE_TEST_SUITE_P(SplitMethods, DeterminismTest,
+                         ::testing::Values(DeterminismCase{SplitMethod::Exact, GrowthPolicy::LevelWise},
+                                           DeterminismCase{SplitMethod::Exact, GrowthPolicy::BestFirst},
+                                           DeterminismCase{SplitMethod::Histogram, GrowthPolicy::LevelWise},
+                                           DeterminismCase{SplitMethod::Histogram, GrowthPolicy::BestFirst}));
+
+} // namespace
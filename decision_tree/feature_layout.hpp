@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+
+//How a block of feature values passed to the batch predictors is laid out
+enum class FeatureLayout {
+    //data[row * nFeatures + feature]
+    RowMajor,
+    //data[feature * nRows + row]
+    ColumnMajor,
+};
+
+//Distance between two features of the same row
+inline std::size_t featureStride(FeatureLayout layout, std::size_t nRows) {
+    return layout == FeatureLayout::RowMajor ? 1 : nRows;
+}
+//Offset of the first feature of a row
+inline std::size_t rowOffset(FeatureLayout layout, std::size_t row, std::size_t nFeatures) {
+    return layout == FeatureLayout::RowMajor ? row * nFeatures : row;
+}
@@ -1,22 +1,15 @@
 #include <iostream>
 #include "decision_tree.hpp"
-
-void trainingLoop(DecisionTree& tree, int epochs = 10) {
-    double lastImpurity = 1.0;
-    for (int i = 0; i < epochs; i++) {
-        tree.runTree();
-        std::cout << "Last impurity: " << lastImpurity << "\n";
-        lastImpurity = tree.calculateAllImpurity();
-        
-        tree.makeSplits();
-        tree.resetTree();
-    }
-
-}
+#include "profiling/profiler.hpp"
 
 int main() {
 
     DecisionTree tree; 
-    trainingLoop(tree);
+    TrainOptions options;
+    options.maxDepth = 10;
+    int leaves = tree.train(options);
+    std::cout << "Leaves: " << leaves << "\n";
+    std::cout << "Last impurity: " << tree.calculateAllImpurity() << "\n";
+    finishProfile();
     return 0;
 }
\ No newline at end of file
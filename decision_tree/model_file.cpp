@@ -0,0 +1,210 @@
+#include "model_file.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+constexpr std::size_t kSectionAlignment = 64;
+
+std::size_t alignSection(std::size_t offset) {
+    return (offset + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+}
+
+//Section offsets from the start of the file, derived from the header counts alone
+struct ModelLayout {
+    std::size_t nodes;
+    std::size_t probabilities;
+    std::size_t leafIndices;
+    std::size_t classIds;
+    std::size_t nameOffsets;
+    std::size_t names;
+    std::size_t end;
+
+    explicit ModelLayout(const ModelHeader& header) {
+        nodes = sizeof(ModelHeader);
+        probabilities = alignSection(nodes + std::size_t(header.nodeCount) * sizeof(FlatNode));
+        leafIndices = alignSection(probabilities + std::size_t(header.leafCount) * header.nClasses * sizeof(double));
+        classIds = alignSection(leafIndices + std::size_t(header.nodeCount) * sizeof(std::uint32_t));
+        nameOffsets = alignSection(classIds + std::size_t(header.nodeCount) * sizeof(std::uint16_t));
+        names = nameOffsets + (std::size_t(header.nClasses) + 1) * sizeof(std::uint32_t);
+        end = names + header.namesSize;
+    }
+};
+
+void place(std::string& payload, std::size_t offset, const void* data, std::size_t size) {
+    if (size > 0) {
+        std::memcpy(&payload[offset - sizeof(ModelHeader)], data, size);
+    }
+}
+
+//Checksum of the header, with its checksum field zeroed, and the payload after it
+std::uint64_t fileChecksum(const ModelHeader& header, const unsigned char* payload) {
+    ModelHeader zeroed = header;
+    zeroed.checksum = 0;
+    std::uint64_t hash = modelChecksum(reinterpret_cast<const unsigned char*>(&zeroed), sizeof(zeroed));
+    return modelChecksum(payload, header.payloadSize, hash);
+}
+
+} // namespace
+
+std::uint64_t modelChecksum(const unsigned char* data, std::size_t size, std::uint64_t seed) {
+    std::uint64_t hash = seed;
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void writeModel(std::ostream& out, const CompiledTreeView& tree, const std::vector<std::string>& classNames) {
+    if (classNames.size() != tree.nClasses) {
+        throw std::runtime_error("Model needs one name per class, got " + std::to_string(classNames.size()) +
+                                 " for " + std::to_string(tree.nClasses) + " classes");
+    }
+    std::vector<std::uint32_t> nameOffsets = {0};
+    std::string names;
+    for (const std::string& name : classNames) {
+        names += name;
+        if (names.size() > std::numeric_limits<std::uint32_t>::max()) {
+            throw std::runtime_error("Class names are too long for a model file");
+        }
+        nameOffsets.push_back(static_cast<std::uint32_t>(names.size()));
+    }
+
+    ModelHeader header = {};
+    std::memcpy(header.magic, kModelMagic, sizeof(header.magic));
+    header.version = kModelVersion;
+    header.byteOrder = kModelByteOrder;
+    header.nodeCount = tree.nodeCount;
+    header.leafCount = tree.leafCount;
+    header.nClasses = tree.nClasses;
+    header.nFeatures = tree.nFeatures;
+    header.depth = tree.depth;
+    header.namesSize = static_cast<std::uint32_t>(names.size());
+
+    //Alignment padding stays zero so the checksum is reproducible
+    ModelLayout layout(header);
+    std::string payload(layout.end - sizeof(ModelHeader), '\0');
+    place(payload, layout.nodes, tree.nodes, std::size_t(tree.nodeCount) * sizeof(FlatNode));
+    place(payload, layout.probabilities, tree.probabilities, std::size_t(tree.leafCount) * tree.nClasses * sizeof(double));
+    place(payload, layout.leafIndices, tree.leafIndices, std::size_t(tree.nodeCount) * sizeof(std::uint32_t));
+    place(payload, layout.classIds, tree.classIds, std::size_t(tree.nodeCount) * sizeof(std::uint16_t));
+    place(payload, layout.nameOffsets, nameOffsets.data(), nameOffsets.size() * sizeof(std::uint32_t));
+    place(payload, layout.names, names.data(), names.size());
+    header.payloadSize = payload.size();
+    header.checksum = fileChecksum(header, reinterpret_cast<const unsigned char*>(payload.data()));
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(payload.data(), payload.size());
+    if (!out) {
+        throw std::runtime_error("Failed to write model");
+    }
+}
+
+void writeModelFile(const std::string& path, const CompiledTreeView& tree, const std::vector<std::string>& classNames) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    writeModel(out, tree, classNames);
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+MappedModel::MappedModel(const std::string& path, bool verify) : file_(path) {
+    if (file_.size() < sizeof(ModelHeader)) {
+        throw std::runtime_error(path + " is too small to be a model file");
+    }
+    //The mapping is page aligned, so every 64 byte aligned section is aligned for its type
+    const ModelHeader& header = *reinterpret_cast<const ModelHeader*>(file_.data());
+    if (std::memcmp(header.magic, kModelMagic, sizeof(header.magic)) != 0) {
+        throw std::runtime_error(path + " is not a model file");
+    }
+    if (header.byteOrder != kModelByteOrder) {
+        throw std::runtime_error(path + " was written with a different byte order");
+    }
+    if (header.version != kModelVersion) {
+        throw std::runtime_error(path + " is model version " + std::to_string(header.version) +
+                                 ", this build reads version " + std::to_string(kModelVersion));
+    }
+    ModelLayout layout(header);
+    if (header.nodeCount == 0 || header.leafCount == 0 || header.nClasses == 0 ||
+        header.payloadSize != file_.size() - sizeof(ModelHeader) || layout.end != file_.size()) {
+        throw std::runtime_error(path + " is truncated or has an inconsistent header");
+    }
+    if (verify && fileChecksum(header, file_.data() + sizeof(ModelHeader)) != header.checksum) {
+        throw std::runtime_error(path + " failed its checksum");
+    }
+
+    const unsigned char* base = file_.data();
+    view_.nodes = reinterpret_cast<const FlatNode*>(base + layout.nodes);
+    view_.probabilities = reinterpret_cast<const double*>(base + layout.probabilities);
+    view_.leafIndices = reinterpret_cast<const std::uint32_t*>(base + layout.leafIndices);
+    view_.classIds = reinterpret_cast<const std::uint16_t*>(base + layout.classIds);
+    view_.nodeCount = header.nodeCount;
+    view_.leafCount = header.leafCount;
+    view_.nClasses = header.nClasses;
+    view_.nFeatures = header.nFeatures;
+    view_.depth = header.depth;
+    nameOffsets_ = reinterpret_cast<const std::uint32_t*>(base + layout.nameOffsets);
+    names_ = reinterpret_cast<const char*>(base + layout.names);
+    namesSize_ = header.namesSize;
+    if (verify) {
+        validateTree();
+    }
+}
+
+void MappedModel::validateTree() const {
+    const std::string& path = file_.path();
+    if (nameOffsets_[0] != 0 || nameOffsets_[view_.nClasses] != namesSize_) {
+        throw std::runtime_error(path + " has a bad class name table");
+    }
+    for (std::uint32_t c = 0; c < view_.nClasses; c++) {
+        if (nameOffsets_[c] > nameOffsets_[c + 1]) {
+            throw std::runtime_error(path + " has a bad class name table");
+        }
+    }
+    //Children come after their parent, so one forward pass settles every depth
+    std::vector<std::uint32_t> depths(view_.nodeCount, 0);
+    std::uint32_t depth = 0;
+    for (std::uint32_t i = 0; i < view_.nodeCount; i++) {
+        const FlatNode& node = view_.nodes[i];
+        bool leaf = node.child == i;
+        bool badChild = !leaf && (node.child <= i || node.child >= view_.nodeCount - 1);
+        bool badFeature = node.feature < 0 || static_cast<std::uint32_t>(node.feature) >= std::max<std::uint32_t>(view_.nFeatures, 1);
+        bool badLeaf = leaf && view_.leafIndices[i] >= view_.leafCount;
+        if (badChild || badFeature || badLeaf || view_.classIds[i] >= view_.nClasses) {
+            throw std::runtime_error(path + " has a corrupt node " + std::to_string(i));
+        }
+        if (leaf) {
+            depth = std::max(depth, depths[i]);
+        } else {
+            depths[node.child] = depths[node.child + 1] = depths[i] + 1;
+        }
+    }
+    //Batch walks take exactly depth steps, fewer would stop them on an internal node
+    if (depth != view_.depth) {
+        throw std::runtime_error(path + " has depth " + std::to_string(view_.depth) + " in its header, its tree is " +
+                                 std::to_string(depth) + " deep");
+    }
+}
+
+std::string_view MappedModel::getClassName(std::uint16_t classId) const {
+    if (classId >= view_.nClasses) {
+        throw std::out_of_range("Class id " + std::to_string(classId) + " is not in the model");
+    }
+    return std::string_view(names_ + nameOffsets_[classId], nameOffsets_[classId + 1] - nameOffsets_[classId]);
+}
+
+std::vector<std::string> MappedModel::getClassNames() const {
+    std::vector<std::string> classNames;
+    for (std::uint32_t c = 0; c < view_.nClasses; c++) {
+        classNames.emplace_back(getClassName(static_cast<std::uint16_t>(c)));
+    }
+    return classNames;
+}
@@ -0,0 +1,87 @@
+//Versioned binary model file. Its sections are laid out exactly like a CompiledTreeView,
+//so a MappedModel serves predictions straight from the mapped pages
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "compiled_tree.hpp"
+#include "../mapped_file/mapped_file.hpp"
+
+//File layout, native byte order, every section starts on a 64 byte boundary:
+//  ModelHeader
+//  nodes          nodeCount FlatNode
+//  probabilities  leafCount * nClasses double
+//  leafIndices    nodeCount uint32
+//  classIds       nodeCount uint16
+//  nameOffsets    nClasses + 1 uint32, class c is names[nameOffsets[c], nameOffsets[c + 1])
+//  names          namesSize bytes of concatenated class names
+struct ModelHeader {
+    char magic[8];
+    std::uint32_t version;
+    //kModelByteOrder as written, a file from a machine with the other endianness reads it swapped
+    std::uint32_t byteOrder;
+    std::uint32_t nodeCount;
+    std::uint32_t leafCount;
+    std::uint32_t nClasses;
+    std::uint32_t nFeatures;
+    std::uint32_t depth;
+    std::uint32_t namesSize;
+    //Bytes after the header
+    std::uint64_t payloadSize;
+    //FNV-1a 64 of this header, with the checksum zeroed, followed by the payload
+    std::uint64_t checksum;
+    std::uint64_t reserved;
+};
+static_assert(sizeof(ModelHeader) == 64, "ModelHeader should stay 64 bytes");
+
+constexpr char kModelMagic[8] = {'D', 'T', 'M', 'O', 'D', 'E', 'L', '\0'};
+constexpr std::uint32_t kModelVersion = 2;
+constexpr std::uint32_t kModelByteOrder = 0x01020304;
+
+//FNV-1a 64, seeded with a previous result to hash in pieces
+std::uint64_t modelChecksum(const unsigned char* data, std::size_t size, std::uint64_t seed = 0xcbf29ce484222325ULL);
+
+//classNames must hold one name per class of the tree
+void writeModel(std::ostream& out, const CompiledTreeView& tree, const std::vector<std::string>& classNames);
+void writeModelFile(const std::string& path, const CompiledTreeView& tree, const std::vector<std::string>& classNames);
+
+//A model file mapped read-only. Opening reads only the header and, when verifying, one checksum pass.
+//Processes mapping the same file share its pages
+class MappedModel {
+private:
+    MappedFile file_;
+    CompiledTreeView view_;
+    const std::uint32_t* nameOffsets_ = nullptr;
+    const char* names_ = nullptr;
+    std::uint32_t namesSize_ = 0;
+
+    //Checks every child, feature, class and leaf index is in range and the header depth is the deepest leaf's,
+    //so a damaged file cannot send a walk out of bounds or stop it short of a leaf
+    void validateTree() const;
+
+public:
+    //verify checks the checksum and the node table. Skipping it leaves only the header and size checks,
+    //for files that were verified once already
+    explicit MappedModel(const std::string& path, bool verify = true);
+    MappedModel(const MappedModel&) = delete;
+    MappedModel& operator=(const MappedModel&) = delete;
+    MappedModel(MappedModel&&) = default;
+    MappedModel& operator=(MappedModel&&) = default;
+
+    //Points into the mapping, valid while this model lives
+    const CompiledTreeView& view() const { return view_; }
+    int totalClasses() const { return view_.nClasses; }
+    int totalFeatures() const { return view_.nFeatures; }
+    std::string_view getClassName(std::uint16_t classId) const;
+    std::vector<std::string> getClassNames() const;
+
+    std::uint16_t predict(const double* row, std::size_t stride = 1) const { return view_.predict(row, stride); }
+    void predictProbabilities(const double* row, double* out, std::size_t stride = 1) const { view_.predictProbabilities(row, out, stride); }
+    void predictBatch(const double* data, std::size_t nRows, FeatureLayout layout, std::uint16_t* out) const { view_.predictBatch(data, nRows, layout, out); }
+    void predictProbabilitiesBatch(const double* data, std::size_t nRows, FeatureLayout layout, double* out) const {
+        view_.predictProbabilitiesBatch(data, nRows, layout, out);
+    }
+};
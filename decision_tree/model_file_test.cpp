@@ -0,0 +1,101 @@
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <gtest/gtest.h>
+#include "decision_tree.hpp"
+#include "model_file.hpp"
+
+namespace {
+
+class ModelFileTest : public ::testing::Test {
+protected:
+    DecisionTree tree_{Dataset("data/iris.data", 4)};
+    std::string path_ = ::testing::TempDir() + "model_file_test.dtm";
+    std::string bytes_;
+
+    void SetUp() override {
+        TrainOptions options;
+        options.maxDepth = 6;
+        tree_.train(options);
+        tree_.save(path_);
+        std::ifstream in(path_, std::ios::binary);
+        bytes_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        ASSERT_GT(bytes_.size(), sizeof(ModelHeader));
+    }
+
+    ModelHeader header() const {
+        ModelHeader header;
+        std::memcpy(&header, bytes_.data(), sizeof(header));
+        return header;
+    }
+    //Writes bytes as another model file and returns what opening it threw, empty when it opened
+    std::string openError(const std::string& bytes) const {
+        std::string path = path_ + ".damaged";
+        std::ofstream(path, std::ios::binary | std::ios::trunc) << bytes;
+        try {
+            MappedModel model(path);
+        } catch (const std::runtime_error& e) {
+            return e.what();
+        }
+        return "";
+    }
+    //The file with one header field replaced
+    std::string withField(std::size_t offset, std::uint32_t value) const {
+        std::string bytes = bytes_;
+        std::memcpy(&bytes[offset], &value, sizeof(value));
+        return bytes;
+    }
+};
+
+TEST_F(ModelFileTest, MappedModelPredictsLikeTheTree) {
+    MappedModel model(path_);
+    const Dataset& dataset = tree_.getDataset();
+    ASSERT_EQ(model.totalClasses(), dataset.totalClasses());
+    EXPECT_EQ(model.getClassNames(), dataset.getClassNames());
+    std::vector<double> row(dataset.totalFeatures());
+    for (int r = 0; r < dataset.totalContainers(); r++) {
+        for (int f = 0; f < dataset.totalFeatures(); f++) {
+            row[f] = dataset.getFeature(r, f);
+        }
+        ASSERT_EQ(model.predict(row.data()), tree_.predict(row.data())) << "row " << r;
+    }
+}
+
+TEST_F(ModelFileTest, RejectsAFlippedPayloadByte) {
+    std::string bytes = bytes_;
+    bytes[sizeof(ModelHeader) + 3] ^= 0x10;
+    EXPECT_NE(openError(bytes).find("failed its checksum"), std::string::npos);
+}
+
+TEST_F(ModelFileTest, RejectsAChangedHeaderDepth) {
+    std::string bytes = withField(offsetof(ModelHeader, depth), header().depth - 1);
+    EXPECT_NE(openError(bytes).find("failed its checksum"), std::string::npos);
+}
+
+TEST_F(ModelFileTest, RejectsAHeaderDepthThatDisagreesWithTheTree) {
+    //A consistent checksum over a wrong depth, only the tree check can catch it
+    std::string bytes = withField(offsetof(ModelHeader, depth), header().depth - 1);
+    ModelHeader changed;
+    std::memcpy(&changed, bytes.data(), sizeof(changed));
+    changed.checksum = 0;
+    std::uint64_t checksum = modelChecksum(reinterpret_cast<const unsigned char*>(&changed), sizeof(changed));
+    checksum = modelChecksum(reinterpret_cast<const unsigned char*>(bytes.data()) + sizeof(ModelHeader), changed.payloadSize, checksum);
+    std::memcpy(&bytes[offsetof(ModelHeader, checksum)], &checksum, sizeof(checksum));
+    EXPECT_NE(openError(bytes).find("in its header"), std::string::npos);
+}
+
+TEST_F(ModelFileTest, RejectsAnotherVersion) {
+    std::string bytes = withField(offsetof(ModelHeader, version), kModelVersion + 1);
+    EXPECT_NE(openError(bytes).find("is model version"), std::string::npos);
+}
+
+TEST_F(ModelFileTest, RejectsATruncatedFile) {
+    EXPECT_NE(openError(bytes_.substr(0, bytes_.size() - 8)).find("truncated"), std::string::npos);
+    EXPECT_NE(openError(bytes_.substr(0, sizeof(ModelHeader) / 2)).find("too small"), std::string::npos);
+}
+
+} // namespace
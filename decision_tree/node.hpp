@@ -1,60 +1,136 @@
 #pragma once
 #include <algorithm>
+#include <cstdint>
 #include <stdexcept>
 #include <vector>
 #include <iostream>
 #include <memory>
-#include <unordered_map>
 #include "../data_container/data_container.hpp"
 #include "dataset/dataset.hpp"
+#include "dataset/feature_bins.hpp"
+#include "class_histogram.hpp"
+#include "criterion.hpp"
+#include "sample_partition.hpp"
+#include "split_scan.hpp"
+#include "profiling/profiler.hpp"
+#include "thread_pool/thread_pool.hpp"
+
+class NodeArena;
+
 //originally was using templates but realized doubles throughout is smarter  
 class Node {
 private:
+    friend class NodeArena;
     int id_;
     // The value which accepts, or sends to the right node when input >= value
     double classifierValue_;
-    std::unique_ptr<Node> leftChild_;
-    std::unique_ptr<Node> rightChild_;
+    //Both live in the same arena as this node, which owns them
+    Node* leftChild_;
+    Node* rightChild_;
+    NodeArena* arena_ = nullptr;
     //The feature which the node is responsible for
     int featureIndex_;
     double impurity_;
     //This bool will identify if a node needs to recalculate it's impurity. If it is frozen, the impurity is accurate
     bool frozen_;
     int nSamples_;
-    //Holds indices of dataContainers it's seen
-    std::vector<std::size_t> sampleIndices_;
-    std::unordered_map<std::string, int> classCounts_;
+    //Rows of the whole tree, shared by all its nodes and created by the first runInput on the root
+    std::shared_ptr<SamplePartition> partition_;
+    //This node's rows are partition_ rows [begin_, end_)
+    std::uint32_t begin_ = 0;
+    std::uint32_t end_ = 0;
+    //Indexed by the dataset's class id
+    std::vector<int> classCounts_;
+    //Regression nodes keep running target sums instead of class counts, variance = squares / n - mean^2
+    bool regression_ = false;
+    TargetSums targetSums_;
+    //Used by the histogram split finder, kept after a split so one child can be derived by subtraction
+    ClassHistogram histogram_;
+    //Class counts captured when the node was last trained. Unlike classCounts_ they survive resetNode,
+    //so predictions stay valid between epochs
+    std::vector<int> predictionCounts_;
+    std::uint16_t predictedClass_ = 0;
+    //Output of a leaf: the mean target in a regression tree, set by the trainer in a boosted one
+    double value_ = 0.0;
 
-    static int& idCounter() {
-        static int counter = 0;
-        return counter;
+    //Back to a fresh leaf for the arena to hand out again. The vectors keep their capacity
+    void recycle(NodeArena* arena, int id) {
+        id_ = id;
+        arena_ = arena;
+        classifierValue_ = 0.0;
+        leftChild_ = nullptr;
+        rightChild_ = nullptr;
+        featureIndex_ = 0;
+        impurity_ = 0.0;
+        frozen_ = true;
+        nSamples_ = 0;
+        partition_.reset();
+        begin_ = 0;
+        end_ = 0;
+        classCounts_.clear();
+        regression_ = false;
+        targetSums_ = TargetSums();
+        histogram_.clear();
+        predictionCounts_.clear();
+        predictedClass_ = 0;
+        value_ = 0.0;
     }
-    static int nextId() { return idCounter()++; }
     void resetSamples() { nSamples_ = 0; }
-    void resetSampleIndices() { sampleIndices_.clear(); }
-    void resetClassCounts() { classCounts_.clear(); }
+    void resetClassCounts() {
+        std::fill(classCounts_.begin(), classCounts_.end(), 0);
+        targetSums_ = TargetSums();
+    }
 public:
-    static int peekNextId() { return idCounter(); }
-
-    explicit Node(double value = 0.0)
-        : id_(nextId()), classifierValue_(value), leftChild_(nullptr), rightChild_(nullptr), featureIndex_(0), impurity_(0.0), frozen_(true), nSamples_(0) {
+    //Nodes are made by a NodeArena, which numbers them
+    Node()
+        : id_(-1), classifierValue_(0.0), leftChild_(nullptr), rightChild_(nullptr), featureIndex_(0), impurity_(0.0), frozen_(true), nSamples_(0) {
 
         }
+    Node(const Node&) = delete;
+    Node& operator=(const Node&) = delete;
 
+    //Dense index of the node in its tree, in creation order with the root at 0. Usable as an offset into per-node arrays
     const int getId() const { return id_; }
     const bool getIsLeaf() const { return leftChild_ == nullptr && rightChild_ == nullptr; } 
     const double getClassifierValue() const { return classifierValue_; }
-    const Node* getLeftChild() const { return leftChild_.get(); }
-    const Node* getRightChild() const { return rightChild_.get(); }
+    const Node* getLeftChild() const { return leftChild_; }
+    const Node* getRightChild() const { return rightChild_; }
+    Node* getLeftChild() { return leftChild_; }
+    Node* getRightChild() { return rightChild_; }
 
     const int getFeatureIndex() const { return featureIndex_; }
-    const double getImpurity() {
-        return frozen_ ? impurity_ : calculateImpurityScore();
+    //Impurity under Criterion, cached until the next sample arrives. A tree sticks to one criterion, so the
+    //cache never mixes two. Regression nodes always report their variance
+    template <typename Criterion = GiniCriterion>
+    double getImpurity() {
+        return frozen_ ? impurity_ : calculateImpurityScore<Criterion>();
     }
     const int getNumberSamples() const {
         return nSamples_;
     }
-    const std::unordered_map<std::string, int>& getClassCounts() const { return classCounts_; }
+    const std::vector<int>& getClassCounts() const { return classCounts_; }
+    bool isRegression() const { return regression_; }
+    const TargetSums& getTargetSums() const { return targetSums_; }
+    //Rows routed here, duplicates included, until the tree is reset. The view is valid until rows are routed again
+    ArrayView<std::uint32_t> getSampleIndices() {
+        syncPartition(false, nullptr);
+        return partition_ ? partition_->getRows(begin_, end_) : ArrayView<std::uint32_t>();
+    }
+    const std::vector<int>& getPredictionCounts() const { return predictionCounts_; }
+    //Majority class of the training samples, lowest class id on ties
+    std::uint16_t getPredictedClass() const { return predictedClass_; }
+    double getValue() const { return value_; }
+    void setValue(double value) { value_ = value; }
+
+    //Read only walk to the leaf a row ends on, feature f of the row is row[f * featureStride]
+    const Node* findLeaf(const double* row, std::size_t featureStride = 1) const {
+        const Node* node = this;
+        while (!node->getIsLeaf()) {
+            double input = row[node->featureIndex_ * featureStride];
+            node = input >= node->classifierValue_ ? node->rightChild_ : node->leftChild_;
+        }
+        return node;
+    }
 
     void setClassifierValue(double value) { classifierValue_ = value; }
     void setFeatureIndex(int newIndex) {featureIndex_ = newIndex; }
@@ -62,170 +138,580 @@ public:
     //Increments and returns new value
     int incrementSamples() { nSamples_++; return nSamples_; }
 
-    //returns the node which the container finishes on
-    const int runInput(const DataContainer& container) {
-        frozen_ = false;
-
-        std::vector<double> features = container.getFeatures();
-        std::string label = container.getLabel();
-        int currentNodeId = this->id_;
-        incrementSamples();
-        sampleIndices_.push_back(container.getId());
-        classCounts_.emplace(container.getLabel(), 0);
-        classCounts_[container.getLabel()]++;
-        if (this->getIsLeaf()) {    
-            return currentNodeId;
+    //returns the node which the row finishes on, reads the row straight out of the dataset columns.
+    //Called on the root: the row joins the tree's partition once, the nodes on its path only count it
+    const int runInput(const Dataset& dataset, std::size_t row) {
+        if (!partition_) {
+            sharePartition(std::make_shared<SamplePartition>(this));
         }
-
-        double input = features.at(featureIndex_);
-
-        if (input >= classifierValue_) {
-            currentNodeId = rightChild_->runInput(container);
-        } else {
-            currentNodeId = leftChild_->runInput(container);
+        partition_->append(dataset, static_cast<std::uint32_t>(row));
+        DT_PROFILE_COUNT(RowsRouted, 1);
+        Node* node = this;
+        while (true) {
+            node->frozen_ = false;
+            node->incrementSamples();
+            node->countSample(dataset, row);
+            if (node->getIsLeaf()) {
+                return node->id_;
+            }
+            double input = dataset.getFeature(row, node->featureIndex_);
+            node = input >= node->classifierValue_ ? node->rightChild_ : node->leftChild_;
         }
-        return currentNodeId;
     }
     //Calculates impurity score of all nodes, returns leaf impurities
+    template <typename Criterion = GiniCriterion>
     double calculateImpurityForward() {
         frozen_ = false;        
-        double thisImpurity = getImpurity();
+        double thisImpurity = getImpurity<Criterion>();
         if (this->getIsLeaf()) {
             return thisImpurity;
         }
-        double leftImpurity = this->leftChild_->calculateImpurityForward();
-        double rightImpurity = this->rightChild_->calculateImpurityForward();
+        double leftImpurity = this->leftChild_->calculateImpurityForward<Criterion>();
+        double rightImpurity = this->rightChild_->calculateImpurityForward<Criterion>();
         return (leftImpurity + rightImpurity) / 2;
     }
     void resetNode() {
-        this->resetSampleIndices();
         this->resetSamples();
         this->resetClassCounts();
         this->frozen_ = false;
     }
     void resetNodeRecursive() {
         this->resetNode();
+        if (partition_) {
+            partition_->clear();
+        }
         if (getIsLeaf()) {
             return;
         }
         this->leftChild_->resetNodeRecursive();
         this->rightChild_->resetNodeRecursive();
     }
-    //Split this node 
-    void createSplit() {
+    //Split this node, the children come from this node's arena
+    void createSplit();
+    //Try selecting a different classifier value / feature
+    template <typename Criterion = GiniCriterion>
+    void optimizeNode(const Dataset& dataset) {
+        if (nSamples_ == 0) {
+            std::cout << "Warning: tried to split a node with no samples, skipping";
+            return;
+        }
         if (!this->getIsLeaf()) {
-            throw std::runtime_error("Node should be a leaf"); //Something is wrong! Node should be a leaf when this is called
+            this->leftChild_->optimizeNode<Criterion>(dataset);
+            this->rightChild_->optimizeNode<Criterion>(dataset);
+            return;
         }
-        this->leftChild_ = std::make_unique<Node>(Node());
-        this->rightChild_ = std::make_unique<Node>(Node());
+        SplitCandidate best = findBestSplit<Criterion>(dataset);
+        if (best.found) {
+            this->applySplit<Criterion>(dataset, best);
+        }
+    return;
     }
-    //Try selecting a different classifier value / feature
-    //epsilon is the arbitrary precision of the search
-    void optimizeNode(const Dataset& dataset) {
-        if (sampleIndices_.size() == 0) {
+    //Same as optimizeNode but only tries splits at the bin edges of the quantized features,
+    //one pass over the samples per leaf instead of a sorted scan
+    template <typename Criterion = GiniCriterion>
+    void optimizeNodeHistogram(const Dataset& dataset, const FeatureBins& bins) {
+        if (nSamples_ == 0) {
             std::cout << "Warning: tried to split a node with no samples, skipping";
             return;
         }
         if (!this->getIsLeaf()) {
-            this->leftChild_->optimizeNode(dataset);
-            this->rightChild_->optimizeNode(dataset);
+            this->prepareChildHistograms(dataset, bins);
+            this->leftChild_->optimizeNodeHistogram<Criterion>(dataset, bins);
+            this->rightChild_->optimizeNodeHistogram<Criterion>(dataset, bins);
             return;
         }
-        int nFeatures = dataset.getContainer(0).getFeatures().size();
-        double bestImpurity = this->getImpurity();
-        int bestFeatureIndex = this->getFeatureIndex();
-        double bestSplitValue = this->getClassifierValue();
-        bool foundBetterSplit = false;
-        for (int i = 0; i < nFeatures; i++) {
-            //Pairwise compare midpoints for better splits
-            std::vector<std::pair<double, std::string>> featureLabels;
-            featureLabels.reserve(sampleIndices_.size());
-            for (auto idx : sampleIndices_) {
-                const DataContainer& thisContainer = dataset.getContainer(idx);
-                featureLabels.push_back({thisContainer.getFeatures()[i], thisContainer.getLabel()});
+        SplitCandidate best = findBestSplitHistogram<Criterion>(dataset, bins);
+        if (best.found) {
+            this->applySplit<Criterion>(dataset, best);
+        }
+    }
+    //Gathers the leaves optimizeNode would visit, in the same order. Internal nodes go to internals when given
+    void collectLeaves(std::vector<Node*>& leaves, std::vector<Node*>* internals = nullptr) {
+        if (nSamples_ == 0) {
+            std::cout << "Warning: tried to split a node with no samples, skipping";
+            return;
+        }
+        if (this->getIsLeaf()) {
+            leaves.push_back(this);
+            return;
+        }
+        if (internals != nullptr) {
+            internals->push_back(this);
+        }
+        this->leftChild_->collectLeaves(leaves, internals);
+        this->rightChild_->collectLeaves(leaves, internals);
+    }
+
+    //Best exact split of this leaf, found is false when nothing beats the current impurity.
+    //With a pool every feature is scanned on its own thread. Winners are merged in feature order
+    //with the same strict comparison as a serial scan, so the result does not depend on the pool.
+    //Splits leaving fewer than minSamplesLeaf samples on either side are not considered.
+    //features limits the scan to those feature indices, all of them when null.
+    //Criterion scores the class counts, the scan is compiled for it so no candidate pays for an indirect call
+    template <typename Criterion = GiniCriterion>
+    SplitCandidate findBestSplit(const Dataset& dataset, ThreadPool* pool = nullptr, int minSamplesLeaf = 1,
+                                 const std::vector<int>* features = nullptr) {
+        capturePrediction();
+        int nFeatures = dataset.totalFeatures();
+        syncPartition(true, pool);
+        DT_PROFILE_SCOPE(Scan);
+        double parentImpurity = this->getImpurity<Criterion>();
+        std::vector<SplitCandidate> perFeature(nFeatures);
+        if (regression_) {
+            forEachFeature(pool, nFeatures, features, [&](int f) {
+                perFeature[f] = scanRegressionFeature(dataset, f, parentImpurity, minSamplesLeaf);
+            });
+            return mergeCandidates(perFeature, parentImpurity);
+        }
+        //Criterion terms of the whole node, the scan moves them from the right side to the left
+        double totalTerms = 0.0;
+        for (int count : classCounts_) {
+            totalTerms += Criterion::term(count);
+        }
+        forEachFeature(pool, nFeatures, features, [&](int f) {
+            perFeature[f] = scanFeature<Criterion>(dataset, f, parentImpurity, totalTerms, minSamplesLeaf);
+        });
+        return mergeCandidates(perFeature, parentImpurity);
+    }
+    //Best split at the bin edges, same merge rules as findBestSplit
+    template <typename Criterion = GiniCriterion>
+    SplitCandidate findBestSplitHistogram(const Dataset& dataset, const FeatureBins& bins, ThreadPool* pool = nullptr, int minSamplesLeaf = 1,
+                                          const std::vector<int>* features = nullptr) {
+        capturePrediction();
+        if (regression_) {
+            return findBestSplitTargetHistogram(dataset, bins, pool, minSamplesLeaf, features);
+        }
+        syncPartition(false, nullptr);
+        DT_PROFILE_SCOPE(Scan);
+        if (histogram_.empty() || histogram_.getNumberSamples() != nSamples_) {
+            histogram_.build(bins, dataset, getSampleIndices(), pool);
+        }
+        int nClasses = histogram_.getNumberClasses();
+        //Class totals of the node, any feature's bins add up to them
+        std::vector<int> totals(nClasses, 0);
+        for (int bin = 0; bin < bins.binCount(0); bin++) {
+            const int* counts = histogram_.binCounts(bins, 0, bin);
+            for (int c = 0; c < nClasses; c++) {
+                totals[c] += counts[c];
+            }
+        }
+        double parentImpurity = this->getImpurity<Criterion>();
+        std::vector<SplitCandidate> perFeature(bins.features());
+        forEachFeature(pool, bins.features(), features, [&](int f) {
+            perFeature[f] = scanHistogramFeature<Criterion>(bins, f, parentImpurity, totals, minSamplesLeaf);
+            DT_PROFILE_COUNT(Candidates, bins.binCount(f) - 1);
+        });
+        return mergeCandidates(perFeature, parentImpurity);
+    }
+    //Gradient and hessian sums over this node's samples
+    GradientSums sumGradients(const GradientStats& stats) {
+        GradientSums sums;
+        for (auto idx : getSampleIndices()) {
+            sums.add(stats.gradients[idx], stats.hessians[idx]);
+        }
+        return sums;
+    }
+    //Best exact split for a boosted tree: same sorted scan and merge rules as findBestSplit, but scored by
+    //gradientScore of the children instead of Gini, so impurity in the result is a gradient score
+    SplitCandidate findBestSplitGradient(const Dataset& dataset, const GradientStats& stats, ThreadPool* pool = nullptr,
+                                         int minSamplesLeaf = 1, const std::vector<int>* features = nullptr) {
+        int nFeatures = dataset.totalFeatures();
+        syncPartition(true, pool);
+        DT_PROFILE_SCOPE(Scan);
+        GradientSums total = sumGradients(stats);
+        double parentScore = gradientScore(total, stats.lambda);
+        std::vector<SplitCandidate> perFeature(nFeatures);
+        forEachFeature(pool, nFeatures, features, [&](int f) {
+            perFeature[f] = scanGradientFeature(dataset, f, stats, total, parentScore, minSamplesLeaf);
+        });
+        return mergeCandidates(perFeature, parentScore);
+    }
+    //Gradient split at the bin edges. The per-bin sums are built for this search only, gradients change every round
+    SplitCandidate findBestSplitGradientHistogram(const FeatureBins& bins, const GradientStats& stats, ThreadPool* pool = nullptr,
+                                                  int minSamplesLeaf = 1, const std::vector<int>* features = nullptr) {
+        syncPartition(false, nullptr);
+        DT_PROFILE_SCOPE(Scan);
+        GradientSums total = sumGradients(stats);
+        ArrayView<std::uint32_t> rows = getSampleIndices();
+        double parentScore = gradientScore(total, stats.lambda);
+        std::vector<GradientSums> binSums(bins.totalBins());
+        std::vector<int> binCounts(bins.totalBins(), 0);
+        std::vector<SplitCandidate> perFeature(bins.features());
+        forEachFeature(pool, bins.features(), features, [&](int f) {
+            const std::uint8_t* codes = bins.getCodeColumn(f);
+            GradientSums* sums = binSums.data() + bins.binOffset(f);
+            int* counts = binCounts.data() + bins.binOffset(f);
+            for (auto idx : rows) {
+                sums[codes[idx]].add(stats.gradients[idx], stats.hessians[idx]);
+                counts[codes[idx]]++;
             }
-            //sort
-            std::sort(featureLabels.begin(), featureLabels.end(), [](const auto& a, const auto& b) {return a.first < b.first;});
-
-            // 3. Linear scan to find best split
-            // Start with all samples on the right
-            std::unordered_map<std::string, int> leftCounts;
-            std::unordered_map<std::string, int> rightCounts = this->classCounts_;
-            
-            int leftTotal = 0;
-            int rightTotal = this->nSamples_;
-
-            for (size_t k = 0; k < featureLabels.size() - 1; k++) {
-                const auto& val = featureLabels[k];
-                const auto& nextVal = featureLabels[k+1];
-                const std::string& label = val.second;
-
-                // Move sample from Right to Left
-                rightCounts[label]--;
-                leftCounts[label]++;
-                leftTotal++;
-                rightTotal--;
-
-                // If adjacent values are identical, we cannot split between them
-                if (val.first == nextVal.first) continue;
-
-                // Calculate Gini for Left
-                double giniLeft = 1.0;
-                for (const auto& [lbl, count] : leftCounts) {
-                    if (count > 0) {
-                        double prob = (double)count / leftTotal;
-                        giniLeft -= prob * prob;
-                    }
+            perFeature[f] = scanGradientBins(f, sums, counts, bins.binCount(f), bins.getEdges(f).data(), total, nSamples_,
+                                             parentScore, stats, minSamplesLeaf);
+            DT_PROFILE_COUNT(Candidates, bins.binCount(f) - 1);
+        });
+        return mergeCandidates(perFeature, parentScore);
+    }
+    //Fresh children: build the smaller histogram, the bigger one is the parent minus the smaller
+    void prepareChildHistograms(const Dataset& dataset, const FeatureBins& bins) {
+        if (this->getIsLeaf()) {
+            return;
+        }
+        bool childrenFresh = leftChild_->getIsLeaf() && rightChild_->getIsLeaf() && leftChild_->histogram_.empty() && rightChild_->histogram_.empty();
+        if (childrenFresh && histogram_.getNumberSamples() == nSamples_ && !histogram_.empty()) {
+            Node* smaller = leftChild_->nSamples_ <= rightChild_->nSamples_ ? leftChild_ : rightChild_;
+            Node* larger = smaller == leftChild_ ? rightChild_ : leftChild_;
+            smaller->histogram_.build(bins, dataset, smaller->getSampleIndices());
+            larger->histogram_.subtract(histogram_, smaller->histogram_);
+        }
+        histogram_.clear();
+    }
+    //Turns this leaf into a split on the candidate. Its range is partitioned in place into the children's,
+    //the sorted lists too when there are any, one feature per pool task
+    template <typename Criterion = GiniCriterion>
+    void applySplit(const Dataset& dataset, const SplitCandidate& split, ThreadPool* pool = nullptr) {
+        //Ranges must be current while this is still a leaf
+        syncPartition(false, nullptr);
+        DT_PROFILE_SCOPE(Split);
+        DT_PROFILE_COUNT(NodesSplit, 1);
+        this->setFeatureIndex(split.featureIndex);
+        this->setClassifierValue(split.splitValue);
+        //recalculate parent impurity
+        this->calculateImpurityScore<Criterion>();
+        this->createSplit();
+        //Hand our samples down, the children can be scanned and predict without routing the dataset again
+        const double* splitColumn = dataset.getFeatureColumn(featureIndex_);
+        for (Node* child : {leftChild_, rightChild_}) {
+            child->classCounts_.assign(classCounts_.size(), 0);
+            child->frozen_ = false;
+        }
+        if (partition_) {
+            std::uint32_t middle = partition_->partitionRows(begin_, end_, splitColumn, classifierValue_);
+            if (partition_->hasSorted()) {
+                partition_->partitionSorted(begin_, end_, splitColumn, classifierValue_, pool);
+            }
+            leftChild_->begin_ = begin_;
+            leftChild_->end_ = middle;
+            rightChild_->begin_ = middle;
+            rightChild_->end_ = end_;
+            for (Node* child : {leftChild_, rightChild_}) {
+                for (auto idx : partition_->getRows(child->begin_, child->end_)) {
+                    child->countSample(dataset, idx);
+                    child->nSamples_++;
                 }
+            }
+        }
+        leftChild_->capturePrediction();
+        rightChild_->capturePrediction();
+    }
+    //Takes the current class counts, or the mean target of a regression node, as what this node predicts
+    void capturePrediction() {
+        setPredictionCounts(classCounts_);
+        if (regression_) {
+            value_ = nSamples_ > 0 ? targetSums_.sum / nSamples_ : 0.0;
+        }
+    }
+    //Drops the histogram once the node is done with it. Its rows live in the tree's partition and cost nothing per node
+    void releaseSamples() {
+        histogram_.clear();
+    }
 
-                // Calculate Gini for Right
-                double giniRight = 1.0;
-                for (const auto& [lbl, count] : rightCounts) {
-                    if (count > 0) {
-                        double prob = (double)count / rightTotal;
-                        giniRight -= prob * prob;
-                    }
-                }
+    
+private:
+    void sharePartition(const std::shared_ptr<SamplePartition>& partition) {
+        partition_ = partition;
+        if (!getIsLeaf()) {
+            leftChild_->sharePartition(partition);
+            rightChild_->sharePartition(partition);
+        }
+    }
+    //Rows routed since the ranges were assigned sit unsorted at the end of the partition. They are placed lazily,
+    //once per batch of rows, by partitioning from the root down along the current splits, and the sorted lists are
+    //rebuilt the same way when withSorted asks for them. The first of several concurrent searches does the work
+    void syncPartition(bool withSorted, ThreadPool* pool) {
+        if (!partition_) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(partition_->getMutex());
+        Node* root = partition_->getRoot();
+        if (!partition_->isLaidOut()) {
+            DT_PROFILE_SCOPE(Route);
+            partition_->startLayout();
+            root->layOutRange(0, partition_->size());
+            partition_->finishLayout();
+        }
+        if (withSorted && !partition_->hasSorted()) {
+            DT_PROFILE_SCOPE(Sort);
+            partition_->buildSorted(pool);
+            root->partitionSortedDown(pool);
+        }
+    }
+    void layOutRange(std::uint32_t begin, std::uint32_t end) {
+        begin_ = begin;
+        end_ = end;
+        if (getIsLeaf()) {
+            return;
+        }
+        const double* splitColumn = partition_->getDataset()->getFeatureColumn(featureIndex_);
+        std::uint32_t middle = partition_->partitionRows(begin, end, splitColumn, classifierValue_);
+        leftChild_->layOutRange(begin, middle);
+        rightChild_->layOutRange(middle, end);
+    }
+    void partitionSortedDown(ThreadPool* pool) {
+        if (getIsLeaf()) {
+            return;
+        }
+        const double* splitColumn = partition_->getDataset()->getFeatureColumn(featureIndex_);
+        partition_->partitionSorted(begin_, end_, splitColumn, classifierValue_, pool);
+        leftChild_->partitionSortedDown(pool);
+        rightChild_->partitionSortedDown(pool);
+    }
+    //This node's rows in ascending order of feature i
+    ArrayView<std::uint32_t> sortedRange(int i) const {
+        return partition_ ? partition_->getSorted(i, begin_, end_) : ArrayView<std::uint32_t>();
+    }
+    //Adds a row to the class counts, or to the target sums when the dataset is a regression
+    void countSample(const Dataset& dataset, std::size_t row) {
+        if (dataset.isRegression()) {
+            regression_ = true;
+            targetSums_.add(dataset.getTarget(row));
+            return;
+        }
+        if (classCounts_.size() != static_cast<std::size_t>(dataset.totalClasses())) {
+            classCounts_.resize(dataset.totalClasses(), 0);
+        }
+        classCounts_[dataset.getClassId(row)]++;
+    }
+    void setPredictionCounts(const std::vector<int>& counts) {
+        predictionCounts_ = counts;
+        predictedClass_ = static_cast<std::uint16_t>(std::max_element(counts.begin(), counts.end()) - counts.begin());
+    }
+    template <typename Body>
+    static void forEachFeature(ThreadPool* pool, int nFeatures, const Body& body) {
+        if (pool != nullptr) {
+            pool->parallelFor(nFeatures, body);
+            return;
+        }
+        for (int i = 0; i < nFeatures; i++) {
+            body(i);
+        }
+    }
+    //Over the listed features only, or all of them when features is null
+    template <typename Body>
+    static void forEachFeature(ThreadPool* pool, int nFeatures, const std::vector<int>* features, const Body& body) {
+        if (features == nullptr) {
+            forEachFeature(pool, nFeatures, [&](std::size_t f) { body(static_cast<int>(f)); });
+            return;
+        }
+        forEachFeature(pool, static_cast<int>(features->size()), [&](std::size_t i) { body((*features)[i]); });
+    }
+    //Linear scan over one presorted feature
+    template <typename Criterion>
+    SplitCandidate scanFeature(const Dataset& dataset, int i, double parentImpurity, double totalTerms, int minSamplesLeaf) const {
+        SplitCandidate best;
+        best.impurity = parentImpurity;
+        //Pairwise compare midpoints for better splits, the samples are already in feature order
+        const double* column = dataset.getFeatureColumn(i);
+        const std::uint16_t* classIds = dataset.getClassIds().data();
+        ArrayView<std::uint32_t> sortedRows = sortedRange(i);
 
-                // Weighted Gini Impurity of the split
-                double weightedImpurity = ((double)leftTotal / nSamples_) * giniLeft + 
-                                          ((double)rightTotal / nSamples_) * giniRight;
+        // Start with all samples on the right
+        std::vector<int> leftCounts(classCounts_.size(), 0);
+        std::vector<int> rightCounts(classCounts_);
+        double leftTerms = 0.0;
+        double rightTerms = totalTerms;
 
-                if (weightedImpurity < bestImpurity) {
-                    bestImpurity = weightedImpurity;
-                    bestFeatureIndex = i;
-                    bestSplitValue = (val.first + nextVal.first) / 2.0;
-                    foundBetterSplit = true;
-                }
+        int leftTotal = 0;
+        int rightTotal = this->nSamples_;
+        std::uint64_t candidates = 0;
+
+        for (size_t k = 0; k + 1 < sortedRows.size(); k++) {
+            double value = column[sortedRows[k]];
+            double nextValue = column[sortedRows[k+1]];
+            std::uint16_t label = classIds[sortedRows[k]];
+
+            // Move sample from Right to Left, only the terms of its class change, so both sides stay current in O(1)
+            leftTerms += Criterion::term(leftCounts[label] + 1) - Criterion::term(leftCounts[label]);
+            rightTerms += Criterion::term(rightCounts[label] - 1) - Criterion::term(rightCounts[label]);
+            rightCounts[label]--;
+            leftCounts[label]++;
+            leftTotal++;
+            rightTotal--;
+
+            // If adjacent values are identical, we cannot split between them
+            if (value == nextValue) continue;
+            if (leftTotal < minSamplesLeaf) continue;
+            if (rightTotal < minSamplesLeaf) break;
+            candidates++;
+
+            double impurityLeft = Criterion::impurity(leftTerms, leftTotal);
+            double impurityRight = Criterion::impurity(rightTerms, rightTotal);
+
+            // Weighted impurity of the split
+            double weightedImpurity = ((double)leftTotal / nSamples_) * impurityLeft +
+                                      ((double)rightTotal / nSamples_) * impurityRight;
+
+            if (weightedImpurity < best.impurity) {
+                best.impurity = weightedImpurity;
+                best.featureIndex = i;
+                best.splitValue = (value + nextValue) / 2.0;
+                best.found = true;
             }
         }
+        DT_PROFILE_COUNT(Candidates, candidates);
+        return best;
+    }
+    //Linear scan over one presorted feature, moving gradient sums instead of class counts
+    SplitCandidate scanGradientFeature(const Dataset& dataset, int i, const GradientStats& stats, const GradientSums& total,
+                                       double parentScore, int minSamplesLeaf) const {
+        SplitCandidate best;
+        best.impurity = parentScore;
+        const double* column = dataset.getFeatureColumn(i);
+        ArrayView<std::uint32_t> sortedRows = sortedRange(i);
+        GradientSums left;
+        int leftTotal = 0;
+        std::uint64_t candidates = 0;
+        for (std::size_t k = 0; k + 1 < sortedRows.size(); k++) {
+            std::uint32_t row = sortedRows[k];
+            double value = column[row];
+            double nextValue = column[sortedRows[k + 1]];
+            left.add(stats.gradients[row], stats.hessians[row]);
+            leftTotal++;
+            GradientSums right = total - left;
+
+            if (value == nextValue) continue;
+            if (leftTotal < minSamplesLeaf || left.hessian < stats.minChildWeight) continue;
+            if (nSamples_ - leftTotal < minSamplesLeaf || right.hessian < stats.minChildWeight) break;
+            candidates++;
 
-        if (foundBetterSplit) {
-            this->setFeatureIndex(bestFeatureIndex);
-            this->setClassifierValue(bestSplitValue);
-            //recalculate parent impurity
-            this->calculateImpurityScore();
-            this->createSplit();
+            double score = gradientScore(left, stats.lambda) + gradientScore(right, stats.lambda);
+            if (score < best.impurity) {
+                best.impurity = score;
+                best.featureIndex = i;
+                best.splitValue = (value + nextValue) / 2.0;
+                best.found = true;
+            }
         }
-    return;
+        DT_PROFILE_COUNT(Candidates, candidates);
+        return best;
     }
+    //Linear scan over one presorted feature of a regression node. The left sums grow by one target per step
+    //and the right ones are the node's minus the left, so each candidate costs O(1)
+    SplitCandidate scanRegressionFeature(const Dataset& dataset, int i, double parentImpurity, int minSamplesLeaf) const {
+        SplitCandidate best;
+        best.impurity = parentImpurity;
+        const double* column = dataset.getFeatureColumn(i);
+        const double* targets = dataset.getTargets().data();
+        ArrayView<std::uint32_t> sortedRows = sortedRange(i);
+        TargetSums left;
+        int leftTotal = 0;
+        std::uint64_t candidates = 0;
+        for (std::size_t k = 0; k + 1 < sortedRows.size(); k++) {
+            double value = column[sortedRows[k]];
+            double nextValue = column[sortedRows[k + 1]];
+            left.add(targets[sortedRows[k]]);
+            leftTotal++;
+            int rightTotal = nSamples_ - leftTotal;
 
-    
-private:
+            if (value == nextValue) continue;
+            if (leftTotal < minSamplesLeaf) continue;
+            if (rightTotal < minSamplesLeaf) break;
+            candidates++;
+
+            double weightedVariance = (squaredError(left, leftTotal) + squaredError(targetSums_ - left, rightTotal)) / nSamples_;
+            if (weightedVariance < best.impurity) {
+                best.impurity = weightedVariance;
+                best.featureIndex = i;
+                best.splitValue = (value + nextValue) / 2.0;
+                best.found = true;
+            }
+        }
+        DT_PROFILE_COUNT(Candidates, candidates);
+        return best;
+    }
+    //Regression split at the bin edges. Per-bin target sums are built for this search only
+    SplitCandidate findBestSplitTargetHistogram(const Dataset& dataset, const FeatureBins& bins, ThreadPool* pool, int minSamplesLeaf,
+                                                const std::vector<int>* features) {
+        double parentImpurity = this->getImpurity();
+        const double* targets = dataset.getTargets().data();
+        ArrayView<std::uint32_t> rows = getSampleIndices();
+        std::vector<TargetSums> binSums(bins.totalBins());
+        std::vector<int> binCounts(bins.totalBins(), 0);
+        std::vector<SplitCandidate> perFeature(bins.features());
+        forEachFeature(pool, bins.features(), features, [&](int f) {
+            const std::uint8_t* codes = bins.getCodeColumn(f);
+            TargetSums* sums = binSums.data() + bins.binOffset(f);
+            int* counts = binCounts.data() + bins.binOffset(f);
+            for (auto idx : rows) {
+                sums[codes[idx]].add(targets[idx]);
+                counts[codes[idx]]++;
+            }
+            perFeature[f] = scanBinnedTargets(f, sums, counts, bins.binCount(f), bins.getEdges(f).data(), targetSums_, nSamples_,
+                                              parentImpurity, minSamplesLeaf);
+            DT_PROFILE_COUNT(Candidates, bins.binCount(f) - 1);
+        });
+        return mergeCandidates(perFeature, parentImpurity);
+    }
+    //Candidate k of a feature puts bins [0, k) left and [k, binCount) right
+    template <typename Criterion>
+    SplitCandidate scanHistogramFeature(const FeatureBins& bins, int i, double parentImpurity, const std::vector<int>& totals, int minSamplesLeaf) const {
+        return scanBinnedFeature<Criterion>(i, histogram_.binCounts(bins, i, 0), bins.binCount(i), bins.getEdges(i).data(),
+                                 histogram_.getNumberClasses(), totals.data(), nSamples_, parentImpurity, minSamplesLeaf);
+    }
+    template <typename Criterion = GiniCriterion>
     double calculateImpurityScore() {
         frozen_ = true;
         int totalElements = getNumberSamples();
-        double currentImpurity = 1.0;
-        for (auto [key, value] : classCounts_) {
-            double classStdDev = (double)value / totalElements;
-            double classVariance = classStdDev * classStdDev;
-            currentImpurity = currentImpurity - classVariance;
+        if (regression_) {
+            this->impurity_ = totalElements > 0 ? squaredError(targetSums_, totalElements) / totalElements : 0.0;
+            return this->impurity_;
         }
-        this->impurity_ = currentImpurity;
-        return currentImpurity;
-        
+        this->impurity_ = classImpurity<Criterion>(classCounts_.data(), static_cast<int>(classCounts_.size()), totalElements);
+        return this->impurity_;
     }
 
 
 
-};
\ No newline at end of file
+};
+
+//Owns the nodes of one tree, in fixed size blocks that never move, so node pointers stay valid while the tree
+//grows. Dropping the tree is O(1) and leaves the blocks for the next one, so retraining allocates nothing until
+//it outgrows the last tree. Nodes are destroyed with the arena, block by block, never recursively.
+//Node ids are arena slots, so they depend on nothing outside the tree. One tree grows on one thread at a time,
+//separate arenas share no state and can be used concurrently
+class NodeArena {
+private:
+    static constexpr std::size_t kBlockNodes = 256;
+    std::vector<std::unique_ptr<Node[]>> blocks_;
+    //Nodes handed out since the last clear, they are the first ones of the blocks
+    std::size_t used_ = 0;
+
+public:
+    //A fresh leaf with the next id, valid until clear
+    Node* create() {
+        if (used_ == blocks_.size() * kBlockNodes) {
+            blocks_.push_back(std::make_unique<Node[]>(kBlockNodes));
+        }
+        Node* node = &getNode(used_);
+        node->recycle(this, static_cast<int>(used_));
+        used_++;
+        return node;
+    }
+    Node& getNode(std::size_t id) { return blocks_[id / kBlockNodes][id % kBlockNodes]; }
+    const Node& getNode(std::size_t id) const { return blocks_[id / kBlockNodes][id % kBlockNodes]; }
+    //Forgets every node at once, their storage is reused by the next create
+    void clear() { used_ = 0; }
+    std::size_t size() const { return used_; }
+};
+
+inline void Node::createSplit() {
+    if (!this->getIsLeaf()) {
+        throw std::runtime_error("Node should be a leaf"); //Something is wrong! Node should be a leaf when this is called
+    }
+    if (arena_ == nullptr) {
+        throw std::runtime_error("Only nodes made by a NodeArena can be split");
+    }
+    this->leftChild_ = arena_->create();
+    this->rightChild_ = arena_->create();
+    leftChild_->partition_ = partition_;
+    rightChild_->partition_ = partition_;
+}
\ No newline at end of file
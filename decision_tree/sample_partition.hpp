@@ -0,0 +1,137 @@
+//Training rows of one tree, kept in a single array that all of its nodes share. Each node owns a contiguous range
+//[begin, end) of it, and a split stably partitions its parent's range in place. A tree of any depth therefore holds one
+//index per routed row, and routing a row allocates nothing per node. The per-feature sorted lists of the exact split
+//search are stored the same way: one copy of the rows per feature, with the same node ranges
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "dataset/dataset.hpp"
+#include "thread_pool/thread_pool.hpp"
+
+class Node;
+
+class SamplePartition {
+private:
+    //Rows in arrival order, grouped into node ranges once laid out. A row routed twice is listed twice
+    std::vector<std::uint32_t> rows_;
+    //Feature f's copy of rows_ starts at f * rows_.size(), in ascending order of that feature inside every node range
+    std::vector<std::uint32_t> sorted_;
+    //Right halves wait here while a range is partitioned, at the same offsets as the range itself,
+    //so ranges of different nodes or features never share scratch
+    std::vector<std::uint32_t> scratch_;
+    const Dataset* dataset_ = nullptr;
+    //Node the rows are routed from, ranges are assigned from it down
+    Node* root_;
+    //Cleared when a row arrives, until the nodes have their ranges again
+    bool laidOut_ = true;
+    bool sortedBuilt_ = false;
+    //Searches of several nodes may find the ranges stale at once
+    std::mutex mutex_;
+
+    //Rows of data[begin, end) below threshold keep their order at the front, the rest follow in order.
+    //Returns where the second group starts
+    static std::uint32_t stablePartition(std::uint32_t* data, std::uint32_t* scratch, std::uint32_t begin, std::uint32_t end,
+                                         const double* column, double threshold) {
+        std::uint32_t left = begin;
+        std::uint32_t right = begin;
+        for (std::uint32_t i = begin; i < end; i++) {
+            std::uint32_t row = data[i];
+            if (column[row] >= threshold) {
+                scratch[right++] = row;
+            } else {
+                data[left++] = row;
+            }
+        }
+        std::copy(scratch + begin, scratch + right, data + left);
+        return left;
+    }
+
+public:
+    explicit SamplePartition(Node* root) : root_(root) {}
+    SamplePartition(const SamplePartition&) = delete;
+    SamplePartition& operator=(const SamplePartition&) = delete;
+
+    Node* getRoot() const { return root_; }
+    const Dataset* getDataset() const { return dataset_; }
+    std::uint32_t size() const { return static_cast<std::uint32_t>(rows_.size()); }
+    std::mutex& getMutex() { return mutex_; }
+    bool isLaidOut() const { return laidOut_; }
+    bool hasSorted() const { return sortedBuilt_; }
+
+    void append(const Dataset& dataset, std::uint32_t row) {
+        dataset_ = &dataset;
+        rows_.push_back(row);
+        laidOut_ = false;
+        sortedBuilt_ = false;
+    }
+    //Forgets the rows but keeps the capacity, so the next epoch routes without allocating
+    void clear() {
+        rows_.clear();
+        laidOut_ = false;
+        sortedBuilt_ = false;
+    }
+    //Called before ranges are assigned again from the root
+    void startLayout() {
+        if (scratch_.size() < rows_.size()) {
+            scratch_.resize(rows_.size());
+        }
+    }
+    void finishLayout() { laidOut_ = true; }
+
+    ArrayView<std::uint32_t> getRows(std::uint32_t begin, std::uint32_t end) const {
+        return ArrayView<std::uint32_t>(rows_.data() + begin, end - begin);
+    }
+    ArrayView<std::uint32_t> getSorted(int feature, std::uint32_t begin, std::uint32_t end) const {
+        return ArrayView<std::uint32_t>(sorted_.data() + static_cast<std::size_t>(feature) * rows_.size() + begin, end - begin);
+    }
+
+    //Splits rows [begin, end) on column >= threshold, returns where the right side starts
+    std::uint32_t partitionRows(std::uint32_t begin, std::uint32_t end, const double* column, double threshold) {
+        return stablePartition(rows_.data(), scratch_.data(), begin, end, column, threshold);
+    }
+    //Same split of every feature's sorted rows, a stable partition keeps both halves sorted
+    void partitionSorted(std::uint32_t begin, std::uint32_t end, const double* column, double threshold, ThreadPool* pool) {
+        std::size_t nRows = rows_.size();
+        auto feature = [&](std::size_t f) {
+            stablePartition(sorted_.data() + f * nRows, scratch_.data() + f * nRows, begin, end, column, threshold);
+        };
+        std::size_t nFeatures = nRows == 0 ? 0 : sorted_.size() / nRows;
+        if (pool != nullptr) {
+            pool->parallelFor(nFeatures, feature);
+            return;
+        }
+        for (std::size_t f = 0; f < nFeatures; f++) {
+            feature(f);
+        }
+    }
+    //Filters the dataset's presorted rows down to the routed ones, O(features * rows) and no sorting. The result is
+    //sorted over the whole array, the root's range, the caller partitions it down to the other nodes
+    void buildSorted(ThreadPool* pool) {
+        int nFeatures = dataset_->totalFeatures();
+        std::size_t nRows = rows_.size();
+        std::vector<int> multiplicity(dataset_->totalContainers(), 0);
+        for (std::uint32_t row : rows_) {
+            multiplicity[row]++;
+        }
+        sorted_.resize(static_cast<std::size_t>(nFeatures) * nRows);
+        if (scratch_.size() < sorted_.size()) {
+            scratch_.resize(sorted_.size());
+        }
+        auto feature = [&](std::size_t f) {
+            std::uint32_t* out = sorted_.data() + f * nRows;
+            for (std::uint32_t row : dataset_->getSortedRows(static_cast<int>(f))) {
+                out = std::fill_n(out, multiplicity[row], row);
+            }
+        };
+        if (pool != nullptr) {
+            pool->parallelFor(nFeatures, feature);
+        } else {
+            for (int f = 0; f < nFeatures; f++) {
+                feature(f);
+            }
+        }
+        sortedBuilt_ = true;
+    }
+};
@@ -0,0 +1,168 @@
+#include "simd_traversal.hpp"
+#include <limits>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define DT_HAS_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define DT_HAS_X86_KERNELS 0
+#endif
+
+namespace {
+
+void predictRangeScalar(const CompiledTreeView& tree, const double* data, std::size_t nRows, FeatureLayout layout,
+                        std::size_t begin, std::size_t end, std::uint16_t* out) {
+    std::size_t stride = featureStride(layout, nRows);
+    for (std::size_t row = begin; row < end; row++) {
+        out[row] = tree.predict(data + rowOffset(layout, row, tree.nFeatures), stride);
+    }
+}
+
+#if DT_HAS_X86_KERNELS
+//A FlatNode is {double threshold, int32 feature, uint32 child}. Read as two 64 bit words per node, word 2i is
+//the threshold and word 2i + 1 holds the feature in its low half and the child in its high half
+
+__attribute__((target("avx2")))
+std::size_t predictRangeAvx2(const CompiledTreeView& tree, const double* data, std::size_t nRows, FeatureLayout layout,
+                             std::size_t begin, std::size_t end, std::uint16_t* out) {
+    const double* thresholds = reinterpret_cast<const double*>(tree.nodes);
+    const long long* packed = reinterpret_cast<const long long*>(tree.nodes) + 1;
+    const __m256i lowHalf = _mm256_set1_epi64x(0xffffffffLL);
+    const __m256i stride = _mm256_set1_epi64x(static_cast<long long>(featureStride(layout, nRows)));
+    const long long rowStep = layout == FeatureLayout::RowMajor ? tree.nFeatures : 1;
+    alignas(32) long long leaves[8];
+
+    std::size_t row = begin;
+    for (; row + 8 <= end; row += 8) {
+        long long base = static_cast<long long>(rowOffset(layout, row, tree.nFeatures));
+        __m256i rowsA = _mm256_setr_epi64x(base, base + rowStep, base + 2 * rowStep, base + 3 * rowStep);
+        __m256i rowsB = _mm256_add_epi64(rowsA, _mm256_set1_epi64x(4 * rowStep));
+        __m256i indexA = _mm256_setzero_si256();
+        __m256i indexB = _mm256_setzero_si256();
+        for (std::uint32_t level = 0; level < tree.depth; level++) {
+            __m256i wordA = _mm256_slli_epi64(indexA, 1);
+            __m256i wordB = _mm256_slli_epi64(indexB, 1);
+            __m256d thresholdA = _mm256_i64gather_pd(thresholds, wordA, 8);
+            __m256d thresholdB = _mm256_i64gather_pd(thresholds, wordB, 8);
+            __m256i nodeA = _mm256_i64gather_epi64(packed, wordA, 8);
+            __m256i nodeB = _mm256_i64gather_epi64(packed, wordB, 8);
+            __m256i offsetA = _mm256_add_epi64(rowsA, _mm256_mul_epu32(_mm256_and_si256(nodeA, lowHalf), stride));
+            __m256i offsetB = _mm256_add_epi64(rowsB, _mm256_mul_epu32(_mm256_and_si256(nodeB, lowHalf), stride));
+            __m256d inputA = _mm256_i64gather_pd(data, offsetA, 8);
+            __m256d inputB = _mm256_i64gather_pd(data, offsetB, 8);
+            //Ordered compare, NaN on either side is false just like the scalar input >= threshold
+            __m256i rightA = _mm256_castpd_si256(_mm256_cmp_pd(inputA, thresholdA, _CMP_GE_OQ));
+            __m256i rightB = _mm256_castpd_si256(_mm256_cmp_pd(inputB, thresholdB, _CMP_GE_OQ));
+            //The mask is all ones (-1) for right, so subtracting it adds one
+            indexA = _mm256_sub_epi64(_mm256_srli_epi64(nodeA, 32), rightA);
+            indexB = _mm256_sub_epi64(_mm256_srli_epi64(nodeB, 32), rightB);
+        }
+        _mm256_store_si256(reinterpret_cast<__m256i*>(leaves), indexA);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(leaves + 4), indexB);
+        for (int lane = 0; lane < 8; lane++) {
+            out[row + lane] = tree.classIds[leaves[lane]];
+        }
+    }
+    return row;
+}
+
+__attribute__((target("avx512f")))
+std::size_t predictRangeAvx512(const CompiledTreeView& tree, const double* data, std::size_t nRows, FeatureLayout layout,
+                               std::size_t begin, std::size_t end, std::uint16_t* out) {
+    const double* thresholds = reinterpret_cast<const double*>(tree.nodes);
+    const long long* packed = reinterpret_cast<const long long*>(tree.nodes) + 1;
+    const __m512i lowHalf = _mm512_set1_epi64(0xffffffffLL);
+    const __m512i one = _mm512_set1_epi64(1);
+    const __m512i stride = _mm512_set1_epi64(static_cast<long long>(featureStride(layout, nRows)));
+    const long long rowStep = layout == FeatureLayout::RowMajor ? tree.nFeatures : 1;
+    alignas(64) long long leaves[16];
+
+    std::size_t row = begin;
+    for (; row + 16 <= end; row += 16) {
+        long long base = static_cast<long long>(rowOffset(layout, row, tree.nFeatures));
+        __m512i rowsA = _mm512_setr_epi64(base, base + rowStep, base + 2 * rowStep, base + 3 * rowStep,
+                                          base + 4 * rowStep, base + 5 * rowStep, base + 6 * rowStep, base + 7 * rowStep);
+        __m512i rowsB = _mm512_add_epi64(rowsA, _mm512_set1_epi64(8 * rowStep));
+        __m512i indexA = _mm512_setzero_si512();
+        __m512i indexB = _mm512_setzero_si512();
+        for (std::uint32_t level = 0; level < tree.depth; level++) {
+            __m512i wordA = _mm512_slli_epi64(indexA, 1);
+            __m512i wordB = _mm512_slli_epi64(indexB, 1);
+            __m512d thresholdA = _mm512_i64gather_pd(wordA, thresholds, 8);
+            __m512d thresholdB = _mm512_i64gather_pd(wordB, thresholds, 8);
+            __m512i nodeA = _mm512_i64gather_epi64(wordA, packed, 8);
+            __m512i nodeB = _mm512_i64gather_epi64(wordB, packed, 8);
+            __m512i offsetA = _mm512_add_epi64(rowsA, _mm512_mul_epu32(_mm512_and_si512(nodeA, lowHalf), stride));
+            __m512i offsetB = _mm512_add_epi64(rowsB, _mm512_mul_epu32(_mm512_and_si512(nodeB, lowHalf), stride));
+            __m512d inputA = _mm512_i64gather_pd(offsetA, data, 8);
+            __m512d inputB = _mm512_i64gather_pd(offsetB, data, 8);
+            __mmask8 rightA = _mm512_cmp_pd_mask(inputA, thresholdA, _CMP_GE_OQ);
+            __mmask8 rightB = _mm512_cmp_pd_mask(inputB, thresholdB, _CMP_GE_OQ);
+            __m512i childA = _mm512_srli_epi64(nodeA, 32);
+            __m512i childB = _mm512_srli_epi64(nodeB, 32);
+            indexA = _mm512_mask_add_epi64(childA, rightA, childA, one);
+            indexB = _mm512_mask_add_epi64(childB, rightB, childB, one);
+        }
+        _mm512_store_si512(leaves, indexA);
+        _mm512_store_si512(leaves + 8, indexB);
+        for (int lane = 0; lane < 16; lane++) {
+            out[row + lane] = tree.classIds[leaves[lane]];
+        }
+    }
+    return row;
+}
+#endif
+
+} // namespace
+
+SimdLevel bestSimdLevel() {
+#if DT_HAS_X86_KERNELS
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) {
+            return SimdLevel::Avx512;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return SimdLevel::Avx2;
+        }
+        return SimdLevel::Scalar;
+    }();
+    return level;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Avx2:
+            return "avx2";
+        case SimdLevel::Avx512:
+            return "avx512";
+        default:
+            return "scalar";
+    }
+}
+
+void predictRangeSimd(const CompiledTreeView& tree, const double* data, std::size_t nRows, FeatureLayout layout,
+                      std::size_t begin, std::size_t end, std::uint16_t* out, SimdLevel level) {
+    std::size_t row = begin;
+#if DT_HAS_X86_KERNELS
+    //Never run a kernel the CPU does not have, whatever the caller asked for
+    if (static_cast<int>(level) > static_cast<int>(bestSimdLevel())) {
+        level = bestSimdLevel();
+    }
+    //The kernels multiply 32 bit halves, offsets beyond that go scalar
+    bool fitsKernel = tree.depth <= kMaxSimdDepth && nRows <= std::numeric_limits<std::uint32_t>::max() &&
+                      tree.nodeCount <= std::numeric_limits<std::uint32_t>::max() / 2;
+    if (fitsKernel && level == SimdLevel::Avx512) {
+        row = predictRangeAvx512(tree, data, nRows, layout, begin, end, out);
+    } else if (fitsKernel && level == SimdLevel::Avx2) {
+        row = predictRangeAvx2(tree, data, nRows, layout, begin, end, out);
+    }
+#else
+    (void)level;
+#endif
+    //Whatever did not fill a whole register
+    predictRangeScalar(tree, data, nRows, layout, row, end, out);
+}
@@ -0,0 +1,26 @@
+//Branchless batch walks of a CompiledTreeView, several rows per vector register
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "compiled_tree.hpp"
+#include "feature_layout.hpp"
+
+enum class SimdLevel {
+    Scalar,
+    //4 rows per register, 8 in flight
+    Avx2,
+    //8 rows per register, 16 in flight
+    Avx512,
+};
+
+//Widest kernel this CPU runs, checked once
+SimdLevel bestSimdLevel();
+const char* simdLevelName(SimdLevel level);
+
+//Every lane walks exactly tree.depth levels, so deep trees waste work on the short paths. Past this the scalar walk wins
+constexpr std::uint32_t kMaxSimdDepth = 32;
+
+//Class ids of rows [begin, end) into out[begin, end). Levels the CPU lacks, too deep trees and huge
+//strides fall back to the scalar walk. Every level gives the same answer as CompiledTreeView::predict
+void predictRangeSimd(const CompiledTreeView& tree, const double* data, std::size_t nRows, FeatureLayout layout,
+                      std::size_t begin, std::size_t end, std::uint16_t* out, SimdLevel level = bestSimdLevel());
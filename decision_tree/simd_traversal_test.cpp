@@ -0,0 +1,113 @@
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <utility>
+#include <vector>
+#include <gtest/gtest.h>
+#include "decision_tree.hpp"
+#include "simd_traversal.hpp"
+
+namespace {
+
+constexpr std::uint16_t kUntouched = 0xffff;
+constexpr std::size_t kRows = 1003;
+
+CompiledTree trainIris() {
+    DecisionTree tree(Dataset("data/iris.data", 4));
+    TrainOptions options;
+    options.maxDepth = 10;
+    tree.train(options);
+    return tree.compile();
+}
+
+//A chain kMaxSimdDepth + 8 splits deep on feature 0, every left child a leaf, so the kernels must fall back
+CompiledTree deepChain(int nFeatures) {
+    std::uint32_t splits = kMaxSimdDepth + 8;
+    std::vector<FlatNode> nodes;
+    std::vector<std::uint16_t> classIds;
+    std::vector<std::uint32_t> leafIndices;
+    std::vector<double> probabilities;
+    auto addLeaf = [&](std::uint16_t classId) {
+        std::uint32_t index = static_cast<std::uint32_t>(nodes.size());
+        nodes.push_back({std::numeric_limits<double>::quiet_NaN(), 0, index});
+        classIds.push_back(classId);
+        leafIndices.push_back(static_cast<std::uint32_t>(probabilities.size()) / 2);
+        probabilities.push_back(classId == 0 ? 1.0 : 0.0);
+        probabilities.push_back(classId == 1 ? 1.0 : 0.0);
+    };
+    //Internal node 2k splits at k / splits, its left leaf is 2k + 1 and its right child 2k + 2
+    for (std::uint32_t k = 0; k < splits; k++) {
+        std::uint32_t index = static_cast<std::uint32_t>(nodes.size());
+        nodes.push_back({static_cast<double>(k) / splits, 0, index + 1});
+        classIds.push_back(0);
+        leafIndices.push_back(0);
+        addLeaf(static_cast<std::uint16_t>(k % 2));
+    }
+    addLeaf(1);
+    return CompiledTree(std::move(nodes), std::move(classIds), std::move(leafIndices), std::move(probabilities), nFeatures, 2);
+}
+
+//Rows in layout with features in [-0.1, high), every 7th row has a NaN feature
+std::vector<double> makeRows(std::size_t nRows, int nFeatures, FeatureLayout layout, double high) {
+    std::mt19937_64 random(7);
+    std::uniform_real_distribution<double> value(-0.1, high);
+    std::vector<double> data(nRows * nFeatures);
+    std::size_t stride = featureStride(layout, nRows);
+    for (std::size_t row = 0; row < nRows; row++) {
+        double* first = data.data() + rowOffset(layout, row, nFeatures);
+        for (int f = 0; f < nFeatures; f++) {
+            first[f * stride] = row % 7 == 3 && f == static_cast<int>(row / 7) % nFeatures ? std::numeric_limits<double>::quiet_NaN()
+                                                                                          : value(random);
+        }
+    }
+    return data;
+}
+
+//Every supported level against the scalar walk, and rows outside [begin, end) left alone
+void expectLevelsAgree(const CompiledTree& compiled, FeatureLayout layout, std::size_t begin, std::size_t end, double high = 8.0) {
+    CompiledTreeView tree = compiled.view();
+    std::vector<double> data = makeRows(kRows, static_cast<int>(tree.nFeatures), layout, high);
+    std::size_t stride = featureStride(layout, kRows);
+    std::vector<std::uint16_t> expected(kRows, kUntouched);
+    predictRangeSimd(tree, data.data(), kRows, layout, begin, end, expected.data(), SimdLevel::Scalar);
+    for (std::size_t row = begin; row < end; row++) {
+        ASSERT_EQ(expected[row], tree.predict(data.data() + rowOffset(layout, row, tree.nFeatures), stride)) << "row " << row;
+    }
+    for (SimdLevel level : {SimdLevel::Avx2, SimdLevel::Avx512}) {
+        if (static_cast<int>(level) > static_cast<int>(bestSimdLevel())) {
+            continue;
+        }
+        std::vector<std::uint16_t> actual(kRows, kUntouched);
+        predictRangeSimd(tree, data.data(), kRows, layout, begin, end, actual.data(), level);
+        for (std::size_t row = 0; row < kRows; row++) {
+            ASSERT_EQ(expected[row], actual[row]) << simdLevelName(level) << " row " << row;
+        }
+    }
+}
+
+class SimdTraversalTest : public ::testing::TestWithParam<FeatureLayout> {};
+
+TEST_P(SimdTraversalTest, LevelsMatchScalarOnATrainedTree) {
+    CompiledTree tree = trainIris();
+    ASSERT_GT(tree.depth(), 1u);
+    expectLevelsAgree(tree, GetParam(), 0, kRows);
+}
+
+TEST_P(SimdTraversalTest, LevelsMatchScalarOnRaggedRanges) {
+    CompiledTree tree = trainIris();
+    for (auto [begin, end] : {std::pair<std::size_t, std::size_t>{3, 997}, {5, 21}, {17, 18}, {9, 9}, {1, kRows - 1}}) {
+        expectLevelsAgree(tree, GetParam(), begin, end);
+    }
+}
+
+TEST_P(SimdTraversalTest, TreesDeeperThanTheKernelsFallBack) {
+    CompiledTree tree = deepChain(4);
+    ASSERT_GT(tree.depth(), kMaxSimdDepth);
+    expectLevelsAgree(tree, GetParam(), 0, kRows, 1.1);
+    expectLevelsAgree(tree, GetParam(), 11, 500, 1.1);
+}
+
+INSTANTIATE_TEST_SUITE_P(Layouts, SimdTraversalTest, ::testing::Values(FeatureLayout::RowMajor, FeatureLayout::ColumnMajor));
+
+} // namespace
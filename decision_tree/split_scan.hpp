@@ -0,0 +1,168 @@
+//Split search pieces shared by the in-memory nodes and the streaming trainer
+#pragma once
+#include <vector>
+#include "criterion.hpp"
+
+//Result of a split search on one leaf
+struct SplitCandidate {
+    int featureIndex = 0;
+    double splitValue = 0.0;
+    //Weighted impurity of the two children
+    double impurity = 0.0;
+    //False when no split beats the leaf's own impurity
+    bool found = false;
+};
+
+//Best edge of one binned feature. Candidate k puts bins [0, k) left and [k, nBins) right at edges[k - 1].
+//binCounts holds nClasses counts per bin, totals the class counts of the whole node. Both sides need minSamplesLeaf samples
+template <typename Criterion = GiniCriterion, typename Count>
+SplitCandidate scanBinnedFeature(int feature, const Count* binCounts, int nBins, const double* edges, int nClasses,
+                                 const Count* totals, Count nSamples, double parentImpurity, Count minSamplesLeaf = 1) {
+    SplitCandidate best;
+    best.impurity = parentImpurity;
+    std::vector<Count> leftCounts(nClasses, 0);
+    Count leftTotal = 0;
+    for (int k = 1; k < nBins; k++) {
+        const Count* counts = binCounts + (k - 1) * nClasses;
+        for (int c = 0; c < nClasses; c++) {
+            leftCounts[c] += counts[c];
+            leftTotal += counts[c];
+        }
+        Count rightTotal = nSamples - leftTotal;
+        if (leftTotal < minSamplesLeaf) continue;
+        if (rightTotal < minSamplesLeaf) break;
+
+        //A whole bin moves at once, so both sides are summed afresh over the classes
+        double leftTerms = 0.0;
+        double rightTerms = 0.0;
+        for (int c = 0; c < nClasses; c++) {
+            leftTerms += Criterion::term(static_cast<double>(leftCounts[c]));
+            rightTerms += Criterion::term(static_cast<double>(totals[c] - leftCounts[c]));
+        }
+        double impurityLeft = Criterion::impurity(leftTerms, static_cast<double>(leftTotal));
+        double impurityRight = Criterion::impurity(rightTerms, static_cast<double>(rightTotal));
+        double weightedImpurity = ((double)leftTotal / nSamples) * impurityLeft +
+                                  ((double)rightTotal / nSamples) * impurityRight;
+
+        if (weightedImpurity < best.impurity) {
+            best.impurity = weightedImpurity;
+            best.featureIndex = feature;
+            best.splitValue = edges[k - 1];
+            best.found = true;
+        }
+    }
+    return best;
+}
+
+//Winner of per-feature candidates, taken in feature order with a strict comparison so any scan order gives the same split
+inline SplitCandidate mergeCandidates(const std::vector<SplitCandidate>& perFeature, double parentImpurity) {
+    SplitCandidate best;
+    best.impurity = parentImpurity;
+    for (const SplitCandidate& candidate : perFeature) {
+        if (candidate.found && candidate.impurity < best.impurity) {
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+//Gradient and hessian sums of a set of rows under a twice differentiable loss
+struct GradientSums {
+    double gradient = 0.0;
+    double hessian = 0.0;
+
+    void add(double g, double h) {
+        gradient += g;
+        hessian += h;
+    }
+    GradientSums operator-(const GradientSums& other) const { return {gradient - other.gradient, hessian - other.hessian}; }
+};
+
+//Per-row gradients of the rows a gradient split search reads, with the rules a split has to meet
+struct GradientStats {
+    const double* gradients = nullptr;
+    const double* hessians = nullptr;
+    //L2 penalty on leaf values
+    double lambda = 1.0;
+    //Hessian sum each child of a split must keep
+    double minChildWeight = 0.0;
+};
+
+//Second order loss a leaf holding sums reaches with its best value -G / (H + lambda), lower is better.
+//It plays the part Gini plays for class counts, so SplitCandidate::impurity and mergeCandidates carry it unchanged
+inline double gradientScore(const GradientSums& sums, double lambda) {
+    return -0.5 * sums.gradient * sums.gradient / (sums.hessian + lambda);
+}
+
+//Best edge of one binned feature under gradient statistics. binSums and binCounts hold one entry per bin,
+//total and nSamples cover the whole node. Both sides need minSamplesLeaf samples and minChildWeight hessian
+template <typename Count>
+SplitCandidate scanGradientBins(int feature, const GradientSums* binSums, const Count* binCounts, int nBins, const double* edges,
+                                const GradientSums& total, Count nSamples, double parentScore, const GradientStats& stats,
+                                Count minSamplesLeaf = 1) {
+    SplitCandidate best;
+    best.impurity = parentScore;
+    GradientSums left;
+    Count leftTotal = 0;
+    for (int k = 1; k < nBins; k++) {
+        left.add(binSums[k - 1].gradient, binSums[k - 1].hessian);
+        leftTotal += binCounts[k - 1];
+        GradientSums right = total - left;
+        if (leftTotal < minSamplesLeaf || left.hessian < stats.minChildWeight) continue;
+        if (nSamples - leftTotal < minSamplesLeaf || right.hessian < stats.minChildWeight) break;
+
+        double score = gradientScore(left, stats.lambda) + gradientScore(right, stats.lambda);
+        if (score < best.impurity) {
+            best.impurity = score;
+            best.featureIndex = feature;
+            best.splitValue = edges[k - 1];
+            best.found = true;
+        }
+    }
+    return best;
+}
+
+//Running sum and sum of squares of the regression targets of a set of rows
+struct TargetSums {
+    double sum = 0.0;
+    double squares = 0.0;
+
+    void add(double target) {
+        sum += target;
+        squares += target * target;
+    }
+    TargetSums operator-(const TargetSums& other) const { return {sum - other.sum, squares - other.squares}; }
+};
+
+//Summed squared deviation of n targets from their mean, n times their variance
+inline double squaredError(const TargetSums& sums, double n) {
+    return n > 0 ? sums.squares - sums.sum * sums.sum / n : 0.0;
+}
+
+//Best edge of one binned feature for a regression node, scored by the weighted variance of the children.
+//binSums and binCounts hold one entry per bin, total and nSamples cover the whole node
+template <typename Count>
+SplitCandidate scanBinnedTargets(int feature, const TargetSums* binSums, const Count* binCounts, int nBins, const double* edges,
+                                 const TargetSums& total, Count nSamples, double parentImpurity, Count minSamplesLeaf = 1) {
+    SplitCandidate best;
+    best.impurity = parentImpurity;
+    TargetSums left;
+    Count leftTotal = 0;
+    for (int k = 1; k < nBins; k++) {
+        left.sum += binSums[k - 1].sum;
+        left.squares += binSums[k - 1].squares;
+        leftTotal += binCounts[k - 1];
+        Count rightTotal = nSamples - leftTotal;
+        if (leftTotal < minSamplesLeaf) continue;
+        if (rightTotal < minSamplesLeaf) break;
+
+        double weightedVariance = (squaredError(left, leftTotal) + squaredError(total - left, rightTotal)) / nSamples;
+        if (weightedVariance < best.impurity) {
+            best.impurity = weightedVariance;
+            best.featureIndex = feature;
+            best.splitValue = edges[k - 1];
+            best.found = true;
+        }
+    }
+    return best;
+}
@@ -0,0 +1,25 @@
+#include <cstdlib>
+#include <iostream>
+#include "model_file.hpp"
+#include "streaming_trainer.hpp"
+
+//train_streaming <data.csv> <n_features> <depth> <budget_mb> <out.dtm>
+//Trains without loading the csv into memory and saves the tree as a model file
+int main(int argc, char** argv) {
+    if (argc != 6) {
+        std::cerr << "usage: " << argv[0] << " <data.csv> <n_features> <depth> <budget_mb> <out.dtm>\n";
+        return 1;
+    }
+    try {
+        StreamingOptions options;
+        options.maxDepth = std::atoi(argv[3]);
+        options.memoryBudget = static_cast<std::size_t>(std::atol(argv[4])) << 20;
+        StreamingModel model = trainStreaming(argv[1], std::atoi(argv[2]), options);
+        writeModelFile(argv[5], model.tree.view(), model.classNames);
+        std::cout << "Nodes: " << model.tree.nodeCount() << ", passes: " << model.passes << "\n";
+    } catch (const std::exception& e) {
+        std::cerr << "train_streaming: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,236 @@
+#include "streaming_trainer.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include "split_scan.hpp"
+#include "dataset/csv_reader.hpp"
+
+namespace {
+
+//A node of the tree being grown, kept in breadth-first order
+struct StreamNode {
+    int feature = 0;
+    double threshold = 0.0;
+    //Index of the left child, the right one follows it. -1 for leaves
+    int left = -1;
+    std::vector<std::uint64_t> classCounts;
+};
+
+class StreamingTrainer {
+private:
+    std::string csvPath_;
+    int nFeatures_;
+    StreamingOptions options_;
+    CsvChunkReader reader_;
+    std::size_t sampleRows_;
+    std::size_t histogramBytes_;
+    int nClasses_ = 0;
+    int passes_ = 0;
+    std::vector<std::vector<double>> edges_;
+    std::vector<std::size_t> binOffsets_;
+    std::vector<StreamNode> nodes_;
+
+    static std::size_t chunkRowsFor(int nFeatures, std::size_t budget) {
+        std::size_t readerBudget = budget / 4;
+        std::size_t rowBytes = nFeatures * sizeof(double) + sizeof(std::uint16_t);
+        if (readerBudget <= CsvChunkReader::kReadBytes + rowBytes) {
+            throw std::runtime_error("Memory budget of " + std::to_string(budget) + " bytes is too small to stream");
+        }
+        return (readerBudget - CsvChunkReader::kReadBytes) / rowBytes;
+    }
+
+    //Row count, class counts of the root and a uniform sample of rows, turned into bin edges
+    void sketch() {
+        std::vector<std::vector<double>> sample(nFeatures_);
+        std::mt19937_64 random(0x5eed);
+        std::uint64_t seen = 0;
+        std::vector<std::uint64_t> counts;
+        passes_++;
+        while (reader_.next()) {
+            const FeatureMatrix& chunk = reader_.features();
+            counts.resize(reader_.labels().size(), 0);
+            for (std::size_t row = 0; row < reader_.rows(); row++, seen++) {
+                counts[reader_.labelIds()[row]]++;
+                //Reservoir sampling, every row ends up in the sample with the same probability
+                std::size_t slot = seen;
+                if (seen >= sampleRows_) {
+                    slot = std::uniform_int_distribution<std::uint64_t>(0, seen)(random);
+                    if (slot >= sampleRows_) {
+                        continue;
+                    }
+                }
+                for (int f = 0; f < nFeatures_; f++) {
+                    if (slot == sample[f].size()) {
+                        sample[f].push_back(chunk.at(row, f));
+                    } else {
+                        sample[f][slot] = chunk.at(row, f);
+                    }
+                }
+            }
+        }
+        if (seen == 0) {
+            throw std::runtime_error(csvPath_ + " has no rows to train on");
+        }
+        nClasses_ = static_cast<int>(counts.size());
+        binOffsets_.assign(1, 0);
+        for (int f = 0; f < nFeatures_; f++) {
+            std::sort(sample[f].begin(), sample[f].end());
+            edges_.push_back(FeatureBins::edgesFromSorted(sample[f].data(), sample[f].size(), options_.maxBins));
+            binOffsets_.push_back(binOffsets_.back() + edges_[f].size() + 1);
+            std::vector<double>().swap(sample[f]);
+        }
+        StreamNode root;
+        root.classCounts = counts;
+        nodes_.push_back(root);
+    }
+
+    int findLeaf(const FeatureMatrix& chunk, std::size_t row) const {
+        int index = 0;
+        while (nodes_[index].left >= 0) {
+            const StreamNode& node = nodes_[index];
+            index = node.left + (chunk.at(row, node.feature) >= node.threshold ? 1 : 0);
+        }
+        return index;
+    }
+
+    //One pass filling the histograms of leaves, which must fit the budget together
+    std::vector<std::vector<std::uint64_t>> buildHistograms(const std::vector<int>& leaves) {
+        std::vector<int> slots(nodes_.size(), -1);
+        for (std::size_t i = 0; i < leaves.size(); i++) {
+            slots[leaves[i]] = static_cast<int>(i);
+        }
+        std::vector<std::vector<std::uint64_t>> histograms(leaves.size(), std::vector<std::uint64_t>(binOffsets_.back() * nClasses_, 0));
+        reader_.rewind();
+        passes_++;
+        while (reader_.next()) {
+            const FeatureMatrix& chunk = reader_.features();
+            for (std::size_t row = 0; row < reader_.rows(); row++) {
+                int slot = slots[findLeaf(chunk, row)];
+                if (slot < 0) {
+                    continue;
+                }
+                std::uint64_t* counts = histograms[slot].data();
+                std::uint16_t label = reader_.labelIds()[row];
+                for (int f = 0; f < nFeatures_; f++) {
+                    //Same code as FeatureBins, the number of edges <= value
+                    const std::vector<double>& edges = edges_[f];
+                    std::size_t bin = std::upper_bound(edges.begin(), edges.end(), chunk.at(row, f)) - edges.begin();
+                    counts[(binOffsets_[f] + bin) * nClasses_ + label]++;
+                }
+            }
+        }
+        return histograms;
+    }
+
+    //Splits the leaf when a split beats it, the children take their counts from the histogram
+    bool splitLeaf(int leaf, const std::vector<std::uint64_t>& histogram) {
+        const std::vector<std::uint64_t>& totals = nodes_[leaf].classCounts;
+        std::uint64_t nSamples = 0;
+        for (std::uint64_t count : totals) {
+            nSamples += count;
+        }
+        double parentImpurity = classImpurity<GiniCriterion>(totals.data(), nClasses_, nSamples);
+        std::vector<SplitCandidate> perFeature(nFeatures_);
+        for (int f = 0; f < nFeatures_; f++) {
+            perFeature[f] = scanBinnedFeature<GiniCriterion>(f, histogram.data() + binOffsets_[f] * nClasses_, static_cast<int>(edges_[f].size()) + 1,
+                                              edges_[f].data(), nClasses_, totals.data(), nSamples, parentImpurity);
+        }
+        SplitCandidate best = mergeCandidates(perFeature, parentImpurity);
+        if (!best.found) {
+            return false;
+        }
+        StreamNode left;
+        StreamNode right;
+        left.classCounts.assign(nClasses_, 0);
+        const std::vector<double>& edges = edges_[best.featureIndex];
+        std::size_t splitBin = std::upper_bound(edges.begin(), edges.end(), best.splitValue) - edges.begin();
+        const std::uint64_t* featureCounts = histogram.data() + binOffsets_[best.featureIndex] * nClasses_;
+        for (std::size_t bin = 0; bin < splitBin; bin++) {
+            for (int c = 0; c < nClasses_; c++) {
+                left.classCounts[c] += featureCounts[bin * nClasses_ + c];
+            }
+        }
+        right.classCounts = totals;
+        for (int c = 0; c < nClasses_; c++) {
+            right.classCounts[c] -= left.classCounts[c];
+        }
+        nodes_[leaf].feature = best.featureIndex;
+        nodes_[leaf].threshold = best.splitValue;
+        nodes_[leaf].left = static_cast<int>(nodes_.size());
+        nodes_.push_back(std::move(left));
+        nodes_.push_back(std::move(right));
+        return true;
+    }
+
+    CompiledTree compile() const {
+        std::vector<FlatNode> flat;
+        std::vector<std::uint16_t> classIds;
+        std::vector<std::uint32_t> leafIndices;
+        std::vector<double> probabilities;
+        std::uint32_t leafCount = 0;
+        for (std::size_t i = 0; i < nodes_.size(); i++) {
+            const StreamNode& node = nodes_[i];
+            const std::vector<std::uint64_t>& counts = node.classCounts;
+            classIds.push_back(static_cast<std::uint16_t>(std::max_element(counts.begin(), counts.end()) - counts.begin()));
+            if (node.left >= 0) {
+                flat.push_back({node.threshold, node.feature, static_cast<std::uint32_t>(node.left)});
+                leafIndices.push_back(0);
+                continue;
+            }
+            flat.push_back({std::numeric_limits<double>::quiet_NaN(), 0, static_cast<std::uint32_t>(i)});
+            leafIndices.push_back(leafCount++);
+            std::uint64_t total = 0;
+            for (std::uint64_t count : counts) {
+                total += count;
+            }
+            for (std::uint64_t count : counts) {
+                probabilities.push_back(total > 0 ? (double)count / total : 0.0);
+            }
+        }
+        return CompiledTree(std::move(flat), std::move(classIds), std::move(leafIndices), std::move(probabilities), nFeatures_, nClasses_);
+    }
+
+public:
+    StreamingTrainer(const std::string& csvPath, int nFeatures, const StreamingOptions& options)
+        : csvPath_(csvPath), nFeatures_(nFeatures), options_(options),
+          reader_(csvPath, nFeatures, chunkRowsFor(nFeatures, options.memoryBudget)),
+          //Half the sketch share, edgesFromSorted needs room for the distinct values of a feature
+          sampleRows_(std::max<std::size_t>(1, options.memoryBudget / 4 / (2 * nFeatures * sizeof(double)))),
+          histogramBytes_(options.memoryBudget / 2) {}
+
+    StreamingModel train() {
+        sketch();
+        std::size_t leafBytes = binOffsets_.back() * nClasses_ * sizeof(std::uint64_t);
+        if (leafBytes > histogramBytes_) {
+            throw std::runtime_error("Memory budget of " + std::to_string(options_.memoryBudget) +
+                                     " bytes cannot hold one leaf histogram of " + std::to_string(leafBytes) + " bytes");
+        }
+        std::size_t leavesPerPass = histogramBytes_ / leafBytes;
+        std::vector<int> frontier = {0};
+        for (int depth = 0; depth < options_.maxDepth && !frontier.empty(); depth++) {
+            std::vector<int> next;
+            for (std::size_t begin = 0; begin < frontier.size(); begin += leavesPerPass) {
+                std::vector<int> group(frontier.begin() + begin, frontier.begin() + std::min(frontier.size(), begin + leavesPerPass));
+                std::vector<std::vector<std::uint64_t>> histograms = buildHistograms(group);
+                for (std::size_t i = 0; i < group.size(); i++) {
+                    if (splitLeaf(group[i], histograms[i])) {
+                        next.push_back(nodes_[group[i]].left);
+                        next.push_back(nodes_[group[i]].left + 1);
+                    }
+                }
+            }
+            frontier = std::move(next);
+        }
+        StreamingModel model{compile(), reader_.labels(), passes_};
+        return model;
+    }
+};
+
+} // namespace
+
+StreamingModel trainStreaming(const std::string& csvPath, int nFeatures, const StreamingOptions& options) {
+    StreamingTrainer trainer(csvPath, nFeatures, options);
+    return trainer.train();
+}
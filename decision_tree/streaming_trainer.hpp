@@ -0,0 +1,30 @@
+//Trains a tree on a CSV too big for memory, in repeated bounded passes over the file
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "compiled_tree.hpp"
+#include "dataset/feature_bins.hpp"
+
+struct StreamingOptions {
+    //Bytes training may hold beside the tree itself: the row chunk, the bin sketch and the leaf histograms
+    std::size_t memoryBudget = std::size_t(256) << 20;
+    //Levels to grow, one per epoch like the in-memory training loop
+    int maxDepth = 10;
+    int maxBins = FeatureBins::kMaxBins;
+};
+
+struct StreamingModel {
+    CompiledTree tree;
+    //Indexed by class id, ids follow the order labels first appear in the file
+    std::vector<std::string> classNames;
+    //Passes made over the file, the sketch pass included
+    int passes = 0;
+};
+
+//Level-wise histogram training on csvPath. A first pass counts the rows and classes and samples rows
+//for the bin edges. Each later pass routes every row through the tree so far and fills the histograms
+//of as many frontier leaves as fit in the budget, then those leaves split like Node::findBestSplitHistogram.
+//Memory is set by the budget, not the row count. When every row fits the sample, the bins and so the
+//tree are the same as DecisionTree with SplitMethod::Histogram
+StreamingModel trainStreaming(const std::string& csvPath, int nFeatures, const StreamingOptions& options = {});
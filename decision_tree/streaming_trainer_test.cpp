@@ -0,0 +1,81 @@
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <gtest/gtest.h>
+#include "decision_tree.hpp"
+#include "streaming_trainer.hpp"
+#include "synthetic/synthetic_data.hpp"
+
+namespace {
+
+constexpr int kDepth = 5;
+
+//Wide enough that one leaf histogram is over a megabyte, small enough that every row fits the sample
+//of a budget holding just one of them
+SyntheticOptions syntheticOptions() {
+    SyntheticOptions options;
+    options.rows = 1000;
+    options.features = 48;
+    options.classes = 16;
+    options.distinctValues = 256;
+    options.seed = 3;
+    return options;
+}
+
+class StreamingTrainerTest : public ::testing::Test {
+protected:
+    static std::string csv_;
+
+    static void SetUpTestSuite() {
+        csv_ = ::testing::TempDir() + "streaming_trainer_test.csv";
+        writeSyntheticCsv(syntheticOptions(), csv_);
+    }
+
+    static void expectSameTree(const CompiledTree& expected, const StreamingModel& model) {
+        CompiledTreeView a = expected.view();
+        CompiledTreeView b = model.tree.view();
+        ASSERT_EQ(a.nodeCount, b.nodeCount);
+        ASSERT_EQ(a.depth, b.depth);
+        for (std::uint32_t i = 0; i < a.nodeCount; i++) {
+            ASSERT_EQ(std::memcmp(&a.nodes[i], &b.nodes[i], sizeof(FlatNode)), 0) << "node " << i;
+            ASSERT_EQ(a.classIds[i], b.classIds[i]) << "node " << i;
+        }
+    }
+
+    //The sketch pass and one per level that was scanned, leaves at kDepth are not
+    static int levelPasses(const CompiledTree& tree) { return 1 + std::min(static_cast<int>(tree.depth()) + 1, kDepth); }
+
+    static CompiledTree trainInMemory() {
+        DecisionTree tree(Dataset(csv_, syntheticOptions().features));
+        tree.setSplitMethod(SplitMethod::Histogram);
+        TrainOptions options;
+        options.maxDepth = kDepth;
+        tree.train(options);
+        EXPECT_EQ(tree.getDataset().getClassNames().size(), static_cast<std::size_t>(syntheticOptions().classes));
+        return tree.compile();
+    }
+};
+
+std::string StreamingTrainerTest::csv_;
+
+TEST_F(StreamingTrainerTest, MatchesHistogramTrainingWhenEverythingFits) {
+    CompiledTree expected = trainInMemory();
+    ASSERT_GT(expected.depth(), 2u);
+    StreamingOptions options;
+    options.maxDepth = kDepth;
+    StreamingModel model = trainStreaming(csv_, syntheticOptions().features, options);
+    EXPECT_EQ(model.passes, levelPasses(expected));
+    expectSameTree(expected, model);
+}
+
+TEST_F(StreamingTrainerTest, MatchesHistogramTrainingOverSeveralPassesPerLevel) {
+    CompiledTree expected = trainInMemory();
+    StreamingOptions options;
+    options.maxDepth = kDepth;
+    options.memoryBudget = std::size_t(5) << 20;
+    StreamingModel model = trainStreaming(csv_, syntheticOptions().features, options);
+    EXPECT_GT(model.passes, levelPasses(expected) + 2) << "one pass per level, the budget should force more";
+    expectSameTree(expected, model);
+}
+
+} // namespace
@@ -0,0 +1,259 @@
+#include "gradient_boosting.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+//Keeps hessians of confident rows from reaching zero
+constexpr double kMinHessian = 1e-16;
+//Probabilities are clamped away from 0 before the log of the loss
+constexpr double kMinProbability = 1e-15;
+
+} // namespace
+
+GradientBoosting::GradientBoosting(std::shared_ptr<const Dataset> dataset) : dataset_(std::move(dataset)) {
+    if (!dataset_) {
+        throw std::runtime_error("Gradient boosting needs a dataset");
+    }
+}
+
+void GradientBoosting::scoresToProbabilities(const double* scores, double* out) const {
+    if (nOutputs_ == 1) {
+        out[1] = 1.0 / (1.0 + std::exp(-scores[0]));
+        out[0] = 1.0 - out[1];
+        return;
+    }
+    double largest = *std::max_element(scores, scores + nOutputs_);
+    double total = 0.0;
+    for (int k = 0; k < nOutputs_; k++) {
+        out[k] = std::exp(scores[k] - largest);
+        total += out[k];
+    }
+    for (int k = 0; k < nOutputs_; k++) {
+        out[k] /= total;
+    }
+}
+
+void GradientBoosting::computeGradients(const std::vector<double>& scores, const std::vector<std::uint16_t>& labels,
+                                        std::vector<double>& gradients, std::vector<double>& hessians) const {
+    std::size_t nRows = labels.size();
+    int nClasses = dataset_->totalClasses();
+    std::vector<double> rowScores(nOutputs_);
+    std::vector<double> probabilities(nClasses);
+    for (std::size_t row = 0; row < nRows; row++) {
+        for (int k = 0; k < nOutputs_; k++) {
+            rowScores[k] = scores[k * nRows + row];
+        }
+        scoresToProbabilities(rowScores.data(), probabilities.data());
+        //The logistic output models class 1, softmax output k models class k
+        for (int k = 0; k < nOutputs_; k++) {
+            int modelled = nOutputs_ == 1 ? 1 : k;
+            double p = probabilities[modelled];
+            gradients[k * nRows + row] = p - (labels[row] == modelled ? 1.0 : 0.0);
+            hessians[k * nRows + row] = std::max(p * (1.0 - p), kMinHessian);
+        }
+    }
+}
+
+double GradientBoosting::logLoss(const std::vector<double>& scores, const std::vector<std::uint16_t>& labels) const {
+    std::size_t nRows = labels.size();
+    std::vector<double> rowScores(nOutputs_);
+    std::vector<double> probabilities(dataset_->totalClasses());
+    double loss = 0.0;
+    for (std::size_t row = 0; row < nRows; row++) {
+        for (int k = 0; k < nOutputs_; k++) {
+            rowScores[k] = scores[k * nRows + row];
+        }
+        scoresToProbabilities(rowScores.data(), probabilities.data());
+        loss -= std::log(std::max(probabilities[labels[row]], kMinProbability));
+    }
+    return loss / nRows;
+}
+
+CompiledTree GradientBoosting::fitTree(const BoostingOptions& options, const FeatureBins* bins, const GradientStats& stats, double* scores) {
+    //The previous tree is flattened already, its nodes' storage is reused
+    nodes_.clear();
+    Node* head = nodes_.create();
+    {
+        DT_PROFILE_SCOPE(Route);
+        for (int row = 0; row < dataset_->totalContainers(); row++) {
+            head->runInput(*dataset_, row);
+        }
+    }
+    //Level by level like DecisionTree::train, a leaf stays a leaf once its best split falls short
+    std::vector<Node*> level = {head};
+    std::vector<Node*> leaves;
+    for (int depth = 0; depth < options.maxDepth && !level.empty(); depth++) {
+        std::vector<Node*> next;
+        for (Node* node : level) {
+            SplitCandidate split = bins ? node->findBestSplitGradientHistogram(*bins, stats, pool_.get(), options.minSamplesLeaf)
+                                        : node->findBestSplitGradient(*dataset_, stats, pool_.get(), options.minSamplesLeaf);
+            double gain = gradientScore(node->sumGradients(stats), stats.lambda) - split.impurity;
+            if (!split.found || gain < options.minSplitGain) {
+                leaves.push_back(node);
+                continue;
+            }
+            node->applySplit(*dataset_, split, pool_.get());
+            DT_PROFILE_SPLIT_AT(depth);
+            node->releaseSamples();
+            next.push_back(node->getLeftChild());
+            next.push_back(node->getRightChild());
+        }
+        level = std::move(next);
+    }
+    leaves.insert(leaves.end(), level.begin(), level.end());
+    //Newton step per leaf, shrunk. The training rows a leaf holds take its value without walking the tree
+    for (Node* leaf : leaves) {
+        GradientSums sums = leaf->sumGradients(stats);
+        double value = -options.learningRate * sums.gradient / (sums.hessian + stats.lambda);
+        leaf->setValue(value);
+        for (std::size_t row : leaf->getSampleIndices()) {
+            scores[row] += value;
+        }
+    }
+    return CompiledTree(*head, dataset_->totalFeatures(), 1, LeafOutput::Value);
+}
+
+void GradientBoosting::train(const BoostingOptions& options, const Dataset* validation) {
+    if (options.nRounds <= 0 || options.learningRate <= 0.0 || options.lambda < 0.0) {
+        throw std::runtime_error("Boosting needs positive rounds and learning rate and a non negative lambda");
+    }
+    int nClasses = dataset_->totalClasses();
+    if (nClasses < 2) {
+        throw std::runtime_error("Boosting needs at least two classes");
+    }
+    if (validation != nullptr && validation->totalFeatures() != dataset_->totalFeatures()) {
+        throw std::runtime_error("Validation set has " + std::to_string(validation->totalFeatures()) + " features, training has " +
+                                 std::to_string(dataset_->totalFeatures()));
+    }
+    nOutputs_ = nClasses == 2 ? 1 : nClasses;
+    trees_.clear();
+    validationLoss_.clear();
+    pool_.reset();
+    if (options.nThreads != 1) {
+        pool_ = std::make_unique<ThreadPool>(options.nThreads);
+        if (pool_->size() == 1) {
+            pool_.reset();
+        }
+    }
+    std::unique_ptr<FeatureBins> bins;
+    if (options.splitMethod == SplitMethod::Histogram) {
+        bins = std::make_unique<FeatureBins>(*dataset_, options.maxBins);
+    }
+
+    std::size_t nRows = dataset_->totalContainers();
+    ArrayView<std::uint16_t> classIds = dataset_->getClassIds();
+    std::vector<std::uint16_t> labels(classIds.begin(), classIds.end());
+    std::vector<int> classCounts(nClasses, 0);
+    for (std::uint16_t label : labels) {
+        classCounts[label]++;
+    }
+    //Every class was interned from a row, so no count is 0
+    baseScores_.assign(nOutputs_, 0.0);
+    for (int k = 0; k < nOutputs_; k++) {
+        baseScores_[k] = nOutputs_ == 1 ? std::log((double)classCounts[1] / classCounts[0]) : std::log((double)classCounts[k] / nRows);
+    }
+    std::vector<double> scores(nOutputs_ * nRows);
+    for (int k = 0; k < nOutputs_; k++) {
+        std::fill(scores.begin() + k * nRows, scores.begin() + (k + 1) * nRows, baseScores_[k]);
+    }
+
+    std::size_t nValidation = validation ? validation->totalContainers() : 0;
+    std::vector<std::uint16_t> validationLabels(nValidation);
+    std::vector<double> validationScores(nOutputs_ * nValidation);
+    for (std::size_t row = 0; row < nValidation; row++) {
+        const std::string& name = validation->getClassName(validation->getClassId(row));
+        auto found = std::find(getClassNames().begin(), getClassNames().end(), name);
+        if (found == getClassNames().end()) {
+            throw std::runtime_error("Validation class " + name + " is not in the training set");
+        }
+        validationLabels[row] = static_cast<std::uint16_t>(found - getClassNames().begin());
+    }
+    for (int k = 0; k < nOutputs_; k++) {
+        std::fill(validationScores.begin() + k * nValidation, validationScores.begin() + (k + 1) * nValidation, baseScores_[k]);
+    }
+
+    std::vector<double> gradients(scores.size());
+    std::vector<double> hessians(scores.size());
+    double bestLoss = std::numeric_limits<double>::infinity();
+    int bestRounds = 0;
+    for (int round = 0; round < options.nRounds; round++) {
+        //Every output of a round sees the gradients from the end of the last round
+        computeGradients(scores, labels, gradients, hessians);
+        for (int k = 0; k < nOutputs_; k++) {
+            GradientStats stats;
+            stats.gradients = gradients.data() + k * nRows;
+            stats.hessians = hessians.data() + k * nRows;
+            stats.lambda = options.lambda;
+            stats.minChildWeight = options.minChildWeight;
+            trees_.push_back(fitTree(options, bins.get(), stats, scores.data() + k * nRows));
+        }
+        if (validation == nullptr) {
+            continue;
+        }
+        const double* rows = validation->getFeatureColumn(0);
+        std::size_t stride = validation->getFeatureStride();
+        for (int k = 0; k < nOutputs_; k++) {
+            CompiledTreeView tree = trees_[trees_.size() - nOutputs_ + k].view();
+            for (std::size_t row = 0; row < nValidation; row++) {
+                validationScores[k * nValidation + row] += tree.predictValue(rows + row, stride);
+            }
+        }
+        validationLoss_.push_back(logLoss(validationScores, validationLabels));
+        if (validationLoss_.back() < bestLoss) {
+            bestLoss = validationLoss_.back();
+            bestRounds = round + 1;
+        } else if (options.earlyStoppingRounds > 0 && round + 1 - bestRounds >= options.earlyStoppingRounds) {
+            break;
+        }
+    }
+    //Rounds past the best validation loss only overfit
+    if (validation != nullptr && options.earlyStoppingRounds > 0) {
+        trees_.resize(static_cast<std::size_t>(bestRounds) * nOutputs_);
+    }
+}
+
+void GradientBoosting::predictScores(const double* row, double* out, std::size_t stride) const {
+    std::copy(baseScores_.begin(), baseScores_.end(), out);
+    for (std::size_t t = 0; t < trees_.size(); t++) {
+        out[t % nOutputs_] += trees_[t].view().predictValue(row, stride);
+    }
+}
+
+void GradientBoosting::predictProbabilities(const double* row, double* out, std::size_t stride) const {
+    std::vector<double> scores(nOutputs_);
+    predictScores(row, scores.data(), stride);
+    scoresToProbabilities(scores.data(), out);
+}
+
+std::uint16_t GradientBoosting::predict(const double* row, std::size_t stride) const {
+    std::vector<double> probabilities(dataset_->totalClasses());
+    predictProbabilities(row, probabilities.data(), stride);
+    return static_cast<std::uint16_t>(std::max_element(probabilities.begin(), probabilities.end()) - probabilities.begin());
+}
+
+void GradientBoosting::predictBatch(const double* data, std::size_t nRows, FeatureLayout layout, std::uint16_t* out) const {
+    std::size_t stride = featureStride(layout, nRows);
+    std::size_t nBlocks = (nRows + kBlockRows - 1) / kBlockRows;
+    auto block = [&](std::size_t b) {
+        //Same steps as predict, with the buffers allocated once per block instead of twice per row
+        std::vector<double> scores(nOutputs_);
+        std::vector<double> probabilities(dataset_->totalClasses());
+        std::size_t end = std::min(nRows, (b + 1) * kBlockRows);
+        for (std::size_t row = b * kBlockRows; row < end; row++) {
+            predictScores(data + rowOffset(layout, row, dataset_->totalFeatures()), scores.data(), stride);
+            scoresToProbabilities(scores.data(), probabilities.data());
+            out[row] = static_cast<std::uint16_t>(std::max_element(probabilities.begin(), probabilities.end()) - probabilities.begin());
+        }
+    };
+    if (pool_) {
+        pool_->parallelFor(nBlocks, block);
+        return;
+    }
+    for (std::size_t b = 0; b < nBlocks; b++) {
+        block(b);
+    }
+}
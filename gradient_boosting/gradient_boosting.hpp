@@ -0,0 +1,90 @@
+//Gradient-boosted trees: every round fits small regression trees to the gradients of the log-loss so far
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../dataset/dataset.hpp"
+#include "../dataset/feature_bins.hpp"
+#include "../decision_tree/compiled_tree.hpp"
+#include "../decision_tree/decision_tree.hpp"
+#include "../decision_tree/feature_layout.hpp"
+#include "../decision_tree/node.hpp"
+#include "../thread_pool/thread_pool.hpp"
+
+struct BoostingOptions {
+    //Upper bound, early stopping may end training sooner
+    int nRounds = 100;
+    //Shrinkage, every tree's leaf values are scaled by it
+    double learningRate = 0.1;
+    int maxDepth = 6;
+    int minSamplesLeaf = 1;
+    //L2 penalty on leaf values
+    double lambda = 1.0;
+    //Hessian sum each child of a split must keep
+    double minChildWeight = 1.0;
+    //Smallest drop in gradientScore a split must bring
+    double minSplitGain = 0.0;
+    SplitMethod splitMethod = SplitMethod::Histogram;
+    int maxBins = FeatureBins::kMaxBins;
+    //Stop after this many rounds without a better validation loss and keep the best round's trees.
+    //0 runs every round. Only used when train is given a validation set
+    int earlyStoppingRounds = 0;
+    //Threads for the split search, 0 picks the hardware concurrency. Any count gives the same model
+    int nThreads = 0;
+};
+
+//Two classes train one logistic output, more train one softmax output per class
+class GradientBoosting {
+private:
+    std::shared_ptr<const Dataset> dataset_;
+    //1 for two classes, the class count otherwise
+    int nOutputs_ = 0;
+    //Starting score of every output, the log odds or log shares of the training classes
+    std::vector<double> baseScores_;
+    //Tree of output k in round r at r * nOutputs_ + k
+    std::vector<CompiledTree> trees_;
+    //Mean log-loss on the validation set after every round
+    std::vector<double> validationLoss_;
+    //Null means the calling thread only
+    std::unique_ptr<ThreadPool> pool_;
+    //Nodes of the tree being fitted, reused by every tree
+    NodeArena nodes_;
+    //Rows handed to one pool task by predictBatch
+    static constexpr std::size_t kBlockRows = 4096;
+
+    //Fits one tree to the gradients, adds its learningRate scaled leaf values to the scores of the training rows
+    CompiledTree fitTree(const BoostingOptions& options, const FeatureBins* bins, const GradientStats& stats, double* scores);
+    //Gradients and hessians of every output from the current scores. These, like the scores, hold
+    //output k of row r at k * nRows + r so one output's values are contiguous
+    void computeGradients(const std::vector<double>& scores, const std::vector<std::uint16_t>& labels,
+                          std::vector<double>& gradients, std::vector<double>& hessians) const;
+    //Mean log-loss of rows whose scores are given
+    double logLoss(const std::vector<double>& scores, const std::vector<std::uint16_t>& labels) const;
+    //Class probabilities from nOutputs_ raw scores
+    void scoresToProbabilities(const double* scores, double* out) const;
+
+public:
+    explicit GradientBoosting(std::shared_ptr<const Dataset> dataset);
+    explicit GradientBoosting(Dataset dataset) : GradientBoosting(std::make_shared<const Dataset>(std::move(dataset))) {}
+
+    //Replaces any earlier model. validation is scored after every round, its labels are matched to the
+    //training classes by name
+    void train(const BoostingOptions& options = {}, const Dataset* validation = nullptr);
+
+    int rounds() const { return nOutputs_ == 0 ? 0 : static_cast<int>(trees_.size()) / nOutputs_; }
+    int outputs() const { return nOutputs_; }
+    const CompiledTree& getTree(int round, int output) const { return trees_.at(static_cast<std::size_t>(round) * nOutputs_ + output); }
+    const std::vector<double>& getValidationLoss() const { return validationLoss_; }
+    const Dataset& getDataset() const { return *dataset_; }
+    const std::vector<std::string>& getClassNames() const { return dataset_->getClassNames(); }
+
+    //Raw scores, nOutputs values to out. Feature f of the row is row[f * stride]
+    void predictScores(const double* row, double* out, std::size_t stride = 1) const;
+    //nClasses probabilities to out
+    void predictProbabilities(const double* row, double* out, std::size_t stride = 1) const;
+    //Most probable class, lowest id on ties
+    std::uint16_t predict(const double* row, std::size_t stride = 1) const;
+    void predictBatch(const double* data, std::size_t nRows, FeatureLayout layout, std::uint16_t* out) const;
+};
@@ -0,0 +1,56 @@
+#include "mapped_file.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path) : path_(path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open " + path + ": " + std::strerror(errno));
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Failed to stat " + path + ": " + std::strerror(error));
+    }
+    size_ = static_cast<std::size_t>(info.st_size);
+    //mmap refuses a zero length, an empty file just stays unmapped
+    if (size_ > 0) {
+        void* mapping = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (mapping == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error("Failed to map " + path + ": " + std::strerror(error));
+        }
+        data_ = static_cast<const unsigned char*>(mapping);
+    }
+    //The mapping keeps the file alive on its own
+    ::close(fd);
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)), path_(std::move(other.path_)) {}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        path_ = std::move(other.path_);
+    }
+    return *this;
+}
+
+void MappedFile::unmap() {
+    if (data_ != nullptr) {
+        ::munmap(const_cast<unsigned char*>(data_), size_);
+        data_ = nullptr;
+        size_ = 0;
+    }
+}
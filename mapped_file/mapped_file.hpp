@@ -0,0 +1,29 @@
+//Read-only memory mapping of a whole file
+#pragma once
+#include <cstddef>
+#include <string>
+
+class MappedFile {
+private:
+    const unsigned char* data_ = nullptr;
+    std::size_t size_ = 0;
+    std::string path_;
+
+    void unmap();
+
+public:
+    MappedFile() = default;
+    //Maps the file shared and read-only, so every process mapping it uses the same page cache pages
+    explicit MappedFile(const std::string& path);
+    ~MappedFile() { unmap(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    //Page aligned, null for an empty file
+    const unsigned char* data() const { return data_; }
+    std::size_t size() const { return size_; }
+    const std::string& path() const { return path_; }
+    bool empty() const { return size_ == 0; }
+};
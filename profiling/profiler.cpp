@@ -0,0 +1,207 @@
+#include "profiler.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+//Where finishProfile writes, empty for stderr
+std::string profileOutPath() {
+    const char* path = std::getenv("DT_PROFILE_OUT");
+    return path == nullptr ? "" : path;
+}
+
+//Levels up to the deepest one anything was split at
+std::size_t usedLevels(const ProfileTotals& totals) {
+    std::size_t levels = kProfileLevels;
+    while (levels > 0 && totals.splitsPerLevel[levels - 1] == 0) {
+        levels--;
+    }
+    return levels;
+}
+
+} // namespace
+
+const char* profilePhaseName(ProfilePhase phase) {
+    switch (phase) {
+        case ProfilePhase::Load: return "load";
+        case ProfilePhase::Presort: return "presort";
+        case ProfilePhase::Route: return "route";
+        case ProfilePhase::Sort: return "sort";
+        case ProfilePhase::Scan: return "scan";
+        case ProfilePhase::Split: return "split";
+        case ProfilePhase::Count: break;
+    }
+    return "unknown";
+}
+
+const char* profileCounterName(ProfileCounter counter) {
+    switch (counter) {
+        case ProfileCounter::RowsRouted: return "rows_routed";
+        case ProfileCounter::Candidates: return "candidates";
+        case ProfileCounter::NodesSplit: return "nodes_split";
+        case ProfileCounter::Count: break;
+    }
+    return "unknown";
+}
+
+void ThreadProfile::addPhase(ProfilePhase phase, std::uint64_t startNanos, std::uint64_t durationNanos, bool trace) {
+    std::size_t p = static_cast<std::size_t>(phase);
+    add(phaseNanos_[p], durationNanos);
+    add(phaseCalls_[p], 1);
+    if (trace) {
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        if (events_.size() < kMaxEvents) {
+            events_.push_back({phase, startNanos, durationNanos});
+        }
+    }
+}
+
+void ThreadProfile::addTo(ProfileTotals& totals) const {
+    for (std::size_t p = 0; p < kProfilePhases; p++) {
+        totals.phaseNanos[p] += phaseNanos_[p].load(std::memory_order_relaxed);
+        totals.phaseCalls[p] += phaseCalls_[p].load(std::memory_order_relaxed);
+    }
+    for (std::size_t c = 0; c < kProfileCounters; c++) {
+        totals.counters[c] += counters_[c].load(std::memory_order_relaxed);
+    }
+    for (std::size_t level = 0; level < kProfileLevels; level++) {
+        totals.splitsPerLevel[level] += splitsPerLevel_[level].load(std::memory_order_relaxed);
+    }
+}
+
+std::vector<ProfileEvent> ThreadProfile::getEvents() const {
+    std::lock_guard<std::mutex> lock(eventMutex_);
+    return events_;
+}
+
+void ThreadProfile::reset() {
+    for (auto* values : {&phaseNanos_, &phaseCalls_}) {
+        for (std::atomic<std::uint64_t>& value : *values) {
+            value.store(0, std::memory_order_relaxed);
+        }
+    }
+    for (std::atomic<std::uint64_t>& value : counters_) {
+        value.store(0, std::memory_order_relaxed);
+    }
+    for (std::atomic<std::uint64_t>& value : splitsPerLevel_) {
+        value.store(0, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(eventMutex_);
+    events_.clear();
+}
+
+//A trace is only worth its memory when it is going to be written
+Profiler::Profiler() : tracing_(endsWith(profileOutPath(), ".trace.json")) {}
+
+Profiler& Profiler::instance() {
+    static Profiler profiler;
+    return profiler;
+}
+
+ThreadProfile* Profiler::registerThread() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.push_back(std::make_unique<ThreadProfile>(static_cast<std::uint32_t>(threads_.size())));
+    return threads_.back().get();
+}
+
+void Profiler::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::unique_ptr<ThreadProfile>& thread : threads_) {
+        thread->reset();
+    }
+}
+
+ProfileTotals Profiler::totals() const {
+    ProfileTotals totals;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::unique_ptr<ThreadProfile>& thread : threads_) {
+        thread->addTo(totals);
+    }
+    return totals;
+}
+
+void Profiler::writeText(std::ostream& out) const {
+    ProfileTotals totals = this->totals();
+    out << std::left << std::setw(16) << "phase" << std::right << std::setw(14) << "seconds" << std::setw(14) << "calls" << "\n";
+    for (std::size_t p = 0; p < kProfilePhases; p++) {
+        out << std::left << std::setw(16) << profilePhaseName(static_cast<ProfilePhase>(p)) << std::right << std::setw(14)
+            << std::fixed << std::setprecision(6) << totals.phaseNanos[p] * 1e-9 << std::setw(14) << totals.phaseCalls[p] << "\n";
+    }
+    for (std::size_t c = 0; c < kProfileCounters; c++) {
+        out << std::left << std::setw(16) << profileCounterName(static_cast<ProfileCounter>(c)) << std::right << std::setw(28)
+            << totals.counters[c] << "\n";
+    }
+    out << "splits per level:";
+    for (std::size_t level = 0; level < usedLevels(totals); level++) {
+        out << " " << totals.splitsPerLevel[level];
+    }
+    out << "\n" << std::defaultfloat << std::left;
+}
+
+void Profiler::writeJson(std::ostream& out) const {
+    ProfileTotals totals = this->totals();
+    out << "{\"phases\": {";
+    for (std::size_t p = 0; p < kProfilePhases; p++) {
+        out << (p ? ", " : "") << "\"" << profilePhaseName(static_cast<ProfilePhase>(p)) << "\": {\"seconds\": "
+            << std::setprecision(9) << totals.phaseNanos[p] * 1e-9 << ", \"calls\": " << totals.phaseCalls[p] << "}";
+    }
+    out << "}, \"counters\": {";
+    for (std::size_t c = 0; c < kProfileCounters; c++) {
+        out << (c ? ", " : "") << "\"" << profileCounterName(static_cast<ProfileCounter>(c)) << "\": " << totals.counters[c];
+    }
+    out << "}, \"splits_per_level\": [";
+    for (std::size_t level = 0; level < usedLevels(totals); level++) {
+        out << (level ? ", " : "") << totals.splitsPerLevel[level];
+    }
+    out << "]}\n";
+}
+
+void Profiler::writeChromeTrace(std::ostream& out) const {
+    std::vector<std::pair<std::uint32_t, std::vector<ProfileEvent>>> perThread;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const std::unique_ptr<ThreadProfile>& thread : threads_) {
+            perThread.emplace_back(thread->getThreadIndex(), thread->getEvents());
+        }
+    }
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first = true;
+    out << std::fixed << std::setprecision(3);
+    for (const auto& [threadIndex, events] : perThread) {
+        for (const ProfileEvent& event : events) {
+            out << (first ? "\n" : ",\n") << "{\"name\": \"" << profilePhaseName(event.phase) << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                << threadIndex << ", \"ts\": " << event.startNanos * 1e-3 << ", \"dur\": " << event.durationNanos * 1e-3 << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n" << std::defaultfloat;
+}
+
+void finishProfile() {
+#if DT_PROFILE
+    const Profiler& profiler = Profiler::instance();
+    std::string path = profileOutPath();
+    if (path.empty()) {
+        profiler.writeText(std::cerr);
+        return;
+    }
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    if (endsWith(path, ".trace.json")) {
+        profiler.writeChromeTrace(out);
+    } else if (endsWith(path, ".json")) {
+        profiler.writeJson(out);
+    } else {
+        profiler.writeText(out);
+    }
+#endif
+}
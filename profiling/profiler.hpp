@@ -0,0 +1,165 @@
+//Training profile: time spent per phase and hot path counters, kept per thread and summed for a report.
+//Compiled in with DT_PROFILE=1 (bazel build --define profile=true), otherwise the DT_PROFILE_ macros expand to
+//nothing and training pays for none of it
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifndef DT_PROFILE
+#define DT_PROFILE 0
+#endif
+
+enum class ProfilePhase {
+    //Parsing a dataset
+    Load,
+    //Sorting every feature of a dataset once
+    Presort,
+    //Routing rows from the root, and placing them in the node ranges
+    Route,
+    //Filtering the presorted rows down to a tree's rows
+    Sort,
+    //Split searches, per node
+    Scan,
+    //Partitioning a split node's rows into its children
+    Split,
+    Count,
+};
+enum class ProfileCounter {
+    RowsRouted,
+    //Thresholds whose impurity was computed
+    Candidates,
+    NodesSplit,
+    Count,
+};
+constexpr std::size_t kProfilePhases = static_cast<std::size_t>(ProfilePhase::Count);
+constexpr std::size_t kProfileCounters = static_cast<std::size_t>(ProfileCounter::Count);
+//Splits deeper than this are counted in the last level
+constexpr std::size_t kProfileLevels = 64;
+
+const char* profilePhaseName(ProfilePhase phase);
+const char* profileCounterName(ProfileCounter counter);
+
+//Sums over all threads
+struct ProfileTotals {
+    std::array<std::uint64_t, kProfilePhases> phaseNanos{};
+    std::array<std::uint64_t, kProfilePhases> phaseCalls{};
+    std::array<std::uint64_t, kProfileCounters> counters{};
+    std::array<std::uint64_t, kProfileLevels> splitsPerLevel{};
+};
+
+//One timed phase, for the Chrome trace
+struct ProfileEvent {
+    ProfilePhase phase;
+    //Since the profiler started
+    std::uint64_t startNanos;
+    std::uint64_t durationNanos;
+};
+
+//Counters of one thread. Only that thread writes them, as relaxed loads and stores, so the hot path takes no lock
+//and shares no cache line, and a report can read them at any time
+class ThreadProfile {
+private:
+    std::array<std::atomic<std::uint64_t>, kProfilePhases> phaseNanos_{};
+    std::array<std::atomic<std::uint64_t>, kProfilePhases> phaseCalls_{};
+    std::array<std::atomic<std::uint64_t>, kProfileCounters> counters_{};
+    std::array<std::atomic<std::uint64_t>, kProfileLevels> splitsPerLevel_{};
+    //Events are few, one per timed phase, so a lock the owner almost never contends with is fine
+    mutable std::mutex eventMutex_;
+    std::vector<ProfileEvent> events_;
+    std::uint32_t threadIndex_;
+
+    static void add(std::atomic<std::uint64_t>& value, std::uint64_t amount) {
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+public:
+    //Past this many events a thread stops tracing, so a long job cannot exhaust memory
+    static constexpr std::size_t kMaxEvents = 1 << 20;
+
+    explicit ThreadProfile(std::uint32_t threadIndex) : threadIndex_(threadIndex) {}
+    std::uint32_t getThreadIndex() const { return threadIndex_; }
+
+    void count(ProfileCounter counter, std::uint64_t amount) { add(counters_[static_cast<std::size_t>(counter)], amount); }
+    void countSplit(std::size_t level) { add(splitsPerLevel_[level < kProfileLevels ? level : kProfileLevels - 1], 1); }
+    void addPhase(ProfilePhase phase, std::uint64_t startNanos, std::uint64_t durationNanos, bool trace);
+    void addTo(ProfileTotals& totals) const;
+    std::vector<ProfileEvent> getEvents() const;
+    void reset();
+};
+
+class Profiler {
+private:
+    //Registration and reports only, never the hot path
+    mutable std::mutex mutex_;
+    //Never shrinks, threads keep a pointer to their slot for as long as they live
+    std::vector<std::unique_ptr<ThreadProfile>> threads_;
+    std::atomic<bool> tracing_{false};
+    std::chrono::steady_clock::time_point origin_ = std::chrono::steady_clock::now();
+
+    Profiler();
+    ThreadProfile* registerThread();
+
+public:
+    static Profiler& instance();
+    //The calling thread's counters, registered on first use
+    static ThreadProfile& local() {
+        thread_local ThreadProfile* profile = instance().registerThread();
+        return *profile;
+    }
+    std::uint64_t nowNanos() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin_).count();
+    }
+    //Timed phases also keep an event for writeChromeTrace while this is on
+    void setTracing(bool tracing) { tracing_.store(tracing, std::memory_order_relaxed); }
+    bool isTracing() const { return tracing_.load(std::memory_order_relaxed); }
+    //Zeroes every thread's counters. Call it while nothing is being profiled
+    void reset();
+
+    ProfileTotals totals() const;
+    //Aligned table for people
+    void writeText(std::ostream& out) const;
+    //{"phases": {name: {"seconds", "calls"}}, "counters": {name: value}, "splits_per_level": [...]}
+    void writeJson(std::ostream& out) const;
+    //Trace event format, loads in chrome://tracing and Perfetto
+    void writeChromeTrace(std::ostream& out) const;
+};
+
+//Times a phase on the calling thread from construction to destruction
+class ProfileScope {
+private:
+    ProfilePhase phase_;
+    std::uint64_t start_;
+
+public:
+    explicit ProfileScope(ProfilePhase phase) : phase_(phase), start_(Profiler::instance().nowNanos()) {}
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+    ~ProfileScope() {
+        Profiler& profiler = Profiler::instance();
+        Profiler::local().addPhase(phase_, start_, profiler.nowNanos() - start_, profiler.isTracing());
+    }
+};
+
+//For the end of a training job. Without DT_PROFILE it does nothing. Otherwise the report goes to the file named by
+//the DT_PROFILE_OUT environment variable: a Chrome trace for a .trace.json name, JSON for any other .json name, text
+//otherwise. Without the variable, text goes to stderr
+void finishProfile();
+
+#if DT_PROFILE
+#define DT_PROFILE_JOIN_(a, b) a##b
+#define DT_PROFILE_JOIN(a, b) DT_PROFILE_JOIN_(a, b)
+#define DT_PROFILE_SCOPE(phase) ProfileScope DT_PROFILE_JOIN(profileScope, __LINE__)(ProfilePhase::phase)
+#define DT_PROFILE_COUNT(counter, amount) Profiler::local().count(ProfileCounter::counter, (amount))
+#define DT_PROFILE_SPLIT_AT(level) Profiler::local().countSplit(level)
+#else
+#define DT_PROFILE_SCOPE(phase) ((void)0)
+#define DT_PROFILE_COUNT(counter, amount) ((void)(amount))
+#define DT_PROFILE_SPLIT_AT(level) ((void)(level))
+#endif
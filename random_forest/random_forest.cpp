@@ -0,0 +1,141 @@
+#include "random_forest.hpp"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+
+//Spreads consecutive tree numbers over unrelated seeds
+std::uint64_t splitMix64(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+} // namespace
+
+RandomForest::RandomForest(std::shared_ptr<const Dataset> dataset) : dataset_(std::move(dataset)) {
+    if (!dataset_) {
+        throw std::runtime_error("Random forest needs a dataset");
+    }
+    if (dataset_->isRegression()) {
+        throw std::runtime_error("Random forests vote on classes, the dataset has numeric labels");
+    }
+}
+
+CompiledTree RandomForest::trainTree(const ForestOptions& options, std::shared_ptr<const FeatureBins> bins, int t) const {
+    std::uint64_t treeSeed = splitMix64(options.seed + static_cast<std::uint64_t>(t));
+    TrainOptions treeOptions = options.tree;
+    treeOptions.seed = splitMix64(treeSeed);
+    if (treeOptions.maxFeatures == 0) {
+        treeOptions.maxFeatures = std::max(1, static_cast<int>(std::sqrt(static_cast<double>(dataset_->totalFeatures()))));
+    }
+    DecisionTree tree(dataset_);
+    if (bins) {
+        tree.setBins(std::move(bins));
+    }
+    if (!options.bootstrap) {
+        tree.train(treeOptions);
+        return tree.compile();
+    }
+    std::uint32_t nRows = static_cast<std::uint32_t>(dataset_->totalContainers());
+    std::mt19937_64 random(treeSeed);
+    std::uniform_int_distribution<std::uint32_t> pick(0, nRows - 1);
+    std::vector<std::uint32_t> rows(nRows);
+    for (std::uint32_t& row : rows) {
+        row = pick(random);
+    }
+    tree.train(treeOptions, rows);
+    return tree.compile();
+}
+
+void RandomForest::train(const ForestOptions& options) {
+    if (options.nTrees <= 0) {
+        throw std::runtime_error("Random forest needs at least one tree");
+    }
+    if (dataset_->totalContainers() == 0) {
+        throw std::runtime_error("Cannot train a random forest on an empty dataset");
+    }
+    pool_.reset();
+    if (options.nThreads != 1) {
+        pool_ = std::make_unique<ThreadPool>(options.nThreads);
+        if (pool_->size() == 1) {
+            pool_.reset();
+        }
+    }
+    //Quantized once, every tree reads the same bins
+    std::shared_ptr<const FeatureBins> bins;
+    if (options.splitMethod == SplitMethod::Histogram) {
+        bins = std::make_shared<const FeatureBins>(*dataset_, options.maxBins);
+    }
+    std::vector<CompiledTree> trees(options.nTrees);
+    auto build = [&](std::size_t t) { trees[t] = trainTree(options, bins, static_cast<int>(t)); };
+    if (pool_) {
+        pool_->parallelFor(trees.size(), build);
+    } else {
+        for (std::size_t t = 0; t < trees.size(); t++) {
+            build(t);
+        }
+    }
+    trees_ = std::move(trees);
+}
+
+std::uint16_t RandomForest::predict(const double* row, std::size_t stride) const {
+    std::vector<int> votes(dataset_->totalClasses(), 0);
+    for (const CompiledTree& tree : trees_) {
+        votes[tree.view().predict(row, stride)]++;
+    }
+    return static_cast<std::uint16_t>(std::max_element(votes.begin(), votes.end()) - votes.begin());
+}
+
+void RandomForest::predictProbabilities(const double* row, double* out, std::size_t stride) const {
+    int nClasses = dataset_->totalClasses();
+    std::fill(out, out + nClasses, 0.0);
+    std::vector<double> treeOut(nClasses);
+    for (const CompiledTree& tree : trees_) {
+        tree.view().predictProbabilities(row, treeOut.data(), stride);
+        for (int c = 0; c < nClasses; c++) {
+            out[c] += treeOut[c];
+        }
+    }
+    for (int c = 0; c < nClasses && !trees_.empty(); c++) {
+        out[c] /= trees_.size();
+    }
+}
+
+void RandomForest::voteRange(const double* data, std::size_t nRows, FeatureLayout layout, std::size_t begin, std::size_t end,
+                             std::uint16_t* treeOut, std::uint16_t* out) const {
+    int nClasses = dataset_->totalClasses();
+    std::size_t count = end - begin;
+    std::vector<int> votes(count * nClasses, 0);
+    for (const CompiledTree& tree : trees_) {
+        tree.view().predictRange(data, nRows, layout, begin, end, treeOut);
+        for (std::size_t i = 0; i < count; i++) {
+            votes[i * nClasses + treeOut[begin + i]]++;
+        }
+    }
+    for (std::size_t i = 0; i < count; i++) {
+        const int* rowVotes = votes.data() + i * nClasses;
+        out[begin + i] = static_cast<std::uint16_t>(std::max_element(rowVotes, rowVotes + nClasses) - rowVotes);
+    }
+}
+
+void RandomForest::predictBatch(const double* data, std::size_t nRows, FeatureLayout layout, std::uint16_t* out) const {
+    std::size_t nBlocks = (nRows + kBlockRows - 1) / kBlockRows;
+    //One tree's class ids at a time, every block only touches its own rows
+    std::vector<std::uint16_t> treeOut(nRows);
+    auto block = [&](std::size_t b) {
+        std::size_t begin = b * kBlockRows;
+        voteRange(data, nRows, layout, begin, std::min(nRows, begin + kBlockRows), treeOut.data(), out);
+    };
+    if (pool_) {
+        pool_->parallelFor(nBlocks, block);
+        return;
+    }
+    for (std::size_t b = 0; b < nBlocks; b++) {
+        block(b);
+    }
+}
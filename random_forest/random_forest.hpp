@@ -0,0 +1,65 @@
+//Bagged ensemble of decision trees, trained side by side on one shared read-only dataset
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../dataset/dataset.hpp"
+#include "../decision_tree/compiled_tree.hpp"
+#include "../decision_tree/decision_tree.hpp"
+#include "../decision_tree/feature_layout.hpp"
+#include "../thread_pool/thread_pool.hpp"
+
+struct ForestOptions {
+    int nTrees = 100;
+    //Limits for every tree. maxFeatures 0 tries the square root of the feature count per split, as forests usually do
+    TrainOptions tree;
+    //Every tree trains on n rows drawn with replacement, otherwise on all rows
+    bool bootstrap = true;
+    SplitMethod splitMethod = SplitMethod::Exact;
+    int maxBins = FeatureBins::kMaxBins;
+    //Tree t draws its rows and features from a seed derived from this and t alone,
+    //so the forest does not depend on the thread count or the order trees finish in
+    std::uint64_t seed = 0;
+    //Trees train concurrently, one per thread. 0 picks the hardware concurrency
+    int nThreads = 0;
+};
+
+class RandomForest {
+private:
+    std::shared_ptr<const Dataset> dataset_;
+    std::vector<CompiledTree> trees_;
+    //Null means the calling thread only
+    std::unique_ptr<ThreadPool> pool_;
+    //Rows handed to one pool task by predictBatch
+    static constexpr std::size_t kBlockRows = 4096;
+
+    //Grows tree t and flattens it, the Node tree is dropped straight after
+    CompiledTree trainTree(const ForestOptions& options, std::shared_ptr<const FeatureBins> bins, int t) const;
+    //Majority of the trees' votes over rows [begin, end), ties go to the lowest class id.
+    //treeOut[begin, end) is scratch for one tree's answers
+    void voteRange(const double* data, std::size_t nRows, FeatureLayout layout, std::size_t begin, std::size_t end,
+                   std::uint16_t* treeOut, std::uint16_t* out) const;
+
+public:
+    explicit RandomForest(std::shared_ptr<const Dataset> dataset);
+    explicit RandomForest(Dataset dataset) : RandomForest(std::make_shared<const Dataset>(std::move(dataset))) {}
+
+    //Replaces any trees from an earlier call
+    void train(const ForestOptions& options = {});
+
+    std::size_t treeCount() const { return trees_.size(); }
+    const CompiledTree& getTree(std::size_t t) const { return trees_.at(t); }
+    const Dataset& getDataset() const { return *dataset_; }
+    const std::vector<std::string>& getClassNames() const { return dataset_->getClassNames(); }
+    int getThreadCount() const { return pool_ ? pool_->size() : 1; }
+
+    //Class most trees vote for, feature f of the row is row[f * stride]
+    std::uint16_t predict(const double* row, std::size_t stride = 1) const;
+    //Mean of the trees' leaf probabilities, nClasses values to out
+    void predictProbabilities(const double* row, double* out, std::size_t stride = 1) const;
+    //predict for every row of a batch. Blocks of rows go to the pool and each tree walks a whole block
+    //with the SIMD kernels before the votes are counted
+    void predictBatch(const double* data, std::size_t nRows, FeatureLayout layout, std::uint16_t* out) const;
+};
@@ -0,0 +1,73 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "synthetic_data.hpp"
+#include "../dataset/dataset.hpp"
+#include "../thread_pool/thread_pool.hpp"
+
+//generate_dataset [options] <out.csv>
+//Writes a seeded synthetic dataset, the same options always give the same file
+int main(int argc, char** argv) {
+    const char* usage =
+        " [--rows n] [--features n] [--classes n] [--regression] [--imbalance ratio] [--distinct n]\n"
+        "       [--noise x] [--seed n] [--threads n] [--cache] <out.csv>\n"
+        "  --cache also writes the binary dataset cache next to the csv, classification only\n";
+    SyntheticOptions options;
+    int nThreads = 0;
+    bool cache = false;
+    std::string outPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--regression") {
+            options.labels = LabelType::Numeric;
+        } else if (arg == "--cache") {
+            cache = true;
+        } else if (arg == "--rows" && hasValue) {
+            options.rows = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--features" && hasValue) {
+            options.features = std::atoi(argv[++i]);
+        } else if (arg == "--classes" && hasValue) {
+            options.classes = std::atoi(argv[++i]);
+        } else if (arg == "--imbalance" && hasValue) {
+            options.imbalance = std::atof(argv[++i]);
+        } else if (arg == "--distinct" && hasValue) {
+            options.distinctValues = std::atoi(argv[++i]);
+        } else if (arg == "--noise" && hasValue) {
+            options.noise = std::atof(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--threads" && hasValue) {
+            nThreads = std::atoi(argv[++i]);
+        } else if (arg.rfind("--", 0) != 0 && outPath.empty()) {
+            outPath = arg;
+        } else {
+            std::cerr << "usage: " << argv[0] << usage;
+            return 1;
+        }
+    }
+    if (outPath.empty()) {
+        std::cerr << "usage: " << argv[0] << usage;
+        return 1;
+    }
+    try {
+        if (cache && options.labels == LabelType::Numeric) {
+            throw std::runtime_error("Dataset caches hold class labels only");
+        }
+        std::unique_ptr<ThreadPool> pool;
+        if (nThreads != 1) {
+            pool = std::make_unique<ThreadPool>(nThreads);
+        }
+        writeSyntheticCsv(options, outPath, pool.get());
+        if (cache) {
+            Dataset dataset = Dataset::loadCached(outPath, options.features, pool.get());
+            std::cout << "Cached " << dataset.totalContainers() << " rows\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "generate_dataset: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
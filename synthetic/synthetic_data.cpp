@@ -0,0 +1,188 @@
+#include "synthetic_data.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+//Rows formatted by one pool task
+constexpr std::uint64_t kChunkRows = 1 << 16;
+//Standard deviation of a class blob around its centre
+constexpr double kClassSpread = 0.15;
+constexpr double kTwoPi = 6.283185307179586;
+
+std::uint64_t splitMix64(std::uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+//Draws of one row, hashed from the seed and the row number so no state carries over from other rows.
+//Hand written rather than std distributions, whose output differs between standard libraries
+class RowRandom {
+private:
+    std::uint64_t state_;
+
+public:
+    RowRandom(std::uint64_t seed, std::uint64_t row) : state_(splitMix64(seed ^ splitMix64(row))) {}
+    std::uint64_t next() { return splitMix64(state_++); }
+    //[0, 1), 53 bits
+    double uniform() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+    //Standard normal, Box-Muller
+    double gaussian() {
+        double u1 = 1.0 - uniform();
+        double u2 = uniform();
+        return std::sqrt(-2.0 * std::log(u1)) * std::cos(kTwoPi * u2);
+    }
+};
+
+//Row number the model parameters are drawn from, no real row gets there
+constexpr std::uint64_t kModelRow = std::numeric_limits<std::uint64_t>::max();
+
+void appendNumber(std::string& text, double value) {
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    text.append(buffer, result.ptr);
+}
+
+//Rows [begin, end) as CSV lines into text
+void formatRows(const SyntheticGenerator& generator, std::uint64_t begin, std::uint64_t end, std::string& text) {
+    int nFeatures = generator.getOptions().features;
+    std::vector<double> features(nFeatures);
+    text.clear();
+    for (std::uint64_t r = begin; r < end; r++) {
+        double target = 0.0;
+        std::uint16_t classId = 0;
+        if (generator.isRegression()) {
+            target = generator.generateTargetRow(r, features.data());
+        } else {
+            classId = generator.generateClassRow(r, features.data());
+        }
+        for (double value : features) {
+            appendNumber(text, value);
+            text += ',';
+        }
+        if (generator.isRegression()) {
+            appendNumber(text, target);
+        } else {
+            text += SyntheticGenerator::className(classId);
+        }
+        text += '\n';
+    }
+}
+
+} // namespace
+
+SyntheticGenerator::SyntheticGenerator(const SyntheticOptions& options) : options_(options) {
+    if (options.features <= 0) {
+        throw std::runtime_error("A synthetic dataset needs at least one feature");
+    }
+    if (options.distinctValues < 0 || options.noise < 0.0) {
+        throw std::runtime_error("Distinct values and noise cannot be negative");
+    }
+    int nFeatures = options.features;
+    RowRandom model(options.seed, kModelRow);
+    if (isRegression()) {
+        weights_.resize(nFeatures);
+        for (double& weight : weights_) {
+            weight = 2.0 * model.uniform() - 1.0;
+        }
+        return;
+    }
+    if (options.classes <= 0 || options.classes > std::numeric_limits<std::uint16_t>::max() + 1) {
+        throw std::runtime_error("Classes must be between 1 and 65536, got " + std::to_string(options.classes));
+    }
+    if (options.imbalance < 1.0 || options.noise > 1.0) {
+        throw std::runtime_error("Imbalance must be at least 1 and label noise at most 1");
+    }
+    int nClasses = options.classes;
+    classShares_.resize(nClasses);
+    double total = 0.0;
+    for (int c = 0; c < nClasses; c++) {
+        double exponent = nClasses == 1 ? 0.0 : static_cast<double>(c) / (nClasses - 1);
+        total += std::pow(options.imbalance, -exponent);
+        classShares_[c] = total;
+    }
+    for (double& share : classShares_) {
+        share /= total;
+    }
+    classShares_.back() = 1.0;
+    centres_.resize(static_cast<std::size_t>(nClasses) * nFeatures);
+    for (double& centre : centres_) {
+        centre = model.uniform();
+    }
+}
+
+double SyntheticGenerator::quantize(double value) const {
+    if (options_.distinctValues == 0) {
+        return value;
+    }
+    double levels = options_.distinctValues;
+    return std::min(levels - 1.0, std::floor(std::clamp(value, 0.0, 1.0) * levels)) / levels;
+}
+
+std::uint16_t SyntheticGenerator::generateClassRow(std::uint64_t r, double* features) const {
+    if (isRegression()) {
+        throw std::runtime_error("A regression dataset has no classes");
+    }
+    RowRandom random(options_.seed, r);
+    int nClasses = options_.classes;
+    int classId = static_cast<int>(std::upper_bound(classShares_.begin(), classShares_.end(), random.uniform()) - classShares_.begin());
+    classId = std::min(classId, nClasses - 1);
+    const double* centre = centres_.data() + static_cast<std::size_t>(classId) * options_.features;
+    for (int f = 0; f < options_.features; f++) {
+        features[f] = quantize(centre[f] + kClassSpread * random.gaussian());
+    }
+    if (random.uniform() < options_.noise) {
+        classId = std::min(nClasses - 1, static_cast<int>(random.uniform() * nClasses));
+    }
+    return static_cast<std::uint16_t>(classId);
+}
+
+double SyntheticGenerator::generateTargetRow(std::uint64_t r, double* features) const {
+    if (!isRegression()) {
+        throw std::runtime_error("A classification dataset has no targets");
+    }
+    RowRandom random(options_.seed, r);
+    double target = 0.0;
+    for (int f = 0; f < options_.features; f++) {
+        features[f] = quantize(random.uniform());
+        target += weights_[f] * features[f];
+    }
+    //One interaction, so a tree beats a linear fit
+    target += 2.0 * features[0] * features[(options_.features > 1) ? 1 : 0];
+    return target + options_.noise * random.gaussian();
+}
+
+void writeSyntheticCsv(const SyntheticOptions& options, const std::string& path, ThreadPool* pool) {
+    SyntheticGenerator generator(options);
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    //One chunk per thread in flight, so memory stays bounded however many rows there are
+    std::vector<std::string> chunks(pool ? pool->size() : 1);
+    std::uint64_t batchRows = chunks.size() * kChunkRows;
+    for (std::uint64_t first = 0; first < options.rows; first += batchRows) {
+        auto format = [&](std::size_t c) {
+            std::uint64_t begin = std::min(options.rows, first + c * kChunkRows);
+            formatRows(generator, begin, std::min(options.rows, begin + kChunkRows), chunks[c]);
+        };
+        if (pool) {
+            pool->parallelFor(chunks.size(), format);
+        } else {
+            format(0);
+        }
+        for (const std::string& chunk : chunks) {
+            out.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        }
+    }
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
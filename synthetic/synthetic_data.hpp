@@ -0,0 +1,56 @@
+//Seeded synthetic datasets for scaling tests and benchmarks, of any size and shape
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../dataset/csv_reader.hpp"
+#include "../thread_pool/thread_pool.hpp"
+
+struct SyntheticOptions {
+    //Up to billions, rows are generated and written a chunk at a time
+    std::uint64_t rows = 100000;
+    int features = 8;
+    //Class labels are interned like read ones, Numeric makes a regression target instead
+    LabelType labels = LabelType::Class;
+    int classes = 2;
+    //Frequency of the most common class over the rarest one, the shares in between fall geometrically. 1 is balanced
+    double imbalance = 1.0;
+    //Distinct values a feature takes, fewer means more ties for the split search. 0 leaves the values continuous
+    int distinctValues = 1000;
+    //Classification: share of rows whose label is replaced by a random class.
+    //Regression: standard deviation of the gaussian noise added to the target
+    double noise = 0.1;
+    std::uint64_t seed = 0;
+};
+
+//Classes are gaussian blobs around random centres in the unit cube, so trees have something to find.
+//Regression targets are a random linear mix of the features plus one interaction and noise.
+//Row r depends on the options and r alone, so rows can be generated in any order, on any number of threads
+class SyntheticGenerator {
+private:
+    SyntheticOptions options_;
+    //Cumulative class shares, the last one is 1
+    std::vector<double> classShares_;
+    //Centre of class c in feature f at c * features + f
+    std::vector<double> centres_;
+    //Regression weight of every feature
+    std::vector<double> weights_;
+
+    double quantize(double value) const;
+
+public:
+    //Throws std::runtime_error on options that describe no dataset
+    explicit SyntheticGenerator(const SyntheticOptions& options);
+
+    const SyntheticOptions& getOptions() const { return options_; }
+    bool isRegression() const { return options_.labels == LabelType::Numeric; }
+    static std::string className(int classId) { return "class" + std::to_string(classId); }
+    //Writes the features of row r to features[0, options.features) and returns its class id. Classification only
+    std::uint16_t generateClassRow(std::uint64_t r, double* features) const;
+    //Same for a regression dataset, returns the target
+    double generateTargetRow(std::uint64_t r, double* features) const;
+};
+
+//Streams every row to a CSV that Dataset reads with options.features features (and LabelType::Numeric for a
+//regression). Chunks of rows are formatted on the pool and written in order, the file is the same without it
+void writeSyntheticCsv(const SyntheticOptions& options, const std::string& path, ThreadPool* pool = nullptr);
@@ -0,0 +1,101 @@
+#include "thread_pool.hpp"
+
+namespace {
+//Set while a thread is executing loop bodies, nested loops then run inline
+thread_local bool insideLoop = false;
+}
+
+ThreadPool::ThreadPool(int nThreads) {
+    if (nThreads <= 0) {
+        nThreads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    for (int i = 1; i < nThreads; i++) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::runItems(const std::function<void(std::size_t)>& body) {
+    insideLoop = true;
+    for (std::size_t i = next_.fetch_add(1); i < end_; i = next_.fetch_add(1)) {
+        try {
+            body(i);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+    }
+    insideLoop = false;
+}
+
+void ThreadPool::workerLoop() {
+    std::size_t seenGeneration = 0;
+    while (true) {
+        const std::function<void(std::size_t)>* body;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || generation_ != seenGeneration; });
+            if (stopping_) {
+                return;
+            }
+            seenGeneration = generation_;
+            body = body_;
+            if (body == nullptr) {
+                //Woke up after that loop already finished
+                continue;
+            }
+            busyWorkers_++;
+        }
+        runItems(*body);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            busyWorkers_--;
+        }
+        done_.notify_one();
+    }
+}
+
+void ThreadPool::parallelFor(std::size_t n, const std::function<void(std::size_t)>& body) {
+    std::unique_lock<std::mutex> driver(driverMutex_, std::defer_lock);
+    if (workers_.empty() || insideLoop || n <= 1 || !driver.try_lock()) {
+        for (std::size_t i = 0; i < n; i++) {
+            body(i);
+        }
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        body_ = &body;
+        end_ = n;
+        next_.store(0);
+        error_ = nullptr;
+        generation_++;
+    }
+    wake_.notify_all();
+    runItems(body);
+
+    std::exception_ptr error;
+    {
+        //Workers that woke up late still hold the body, wait for them before it goes out of scope
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] { return busyWorkers_ == 0; });
+        body_ = nullptr;
+        error = error_;
+        error_ = nullptr;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
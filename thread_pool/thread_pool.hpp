@@ -0,0 +1,48 @@
+//Fixed set of worker threads running fork-join loops
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+private:
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    //Held by the thread currently driving a loop
+    std::mutex driverMutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    //Current loop, only one runs at a time
+    const std::function<void(std::size_t)>* body_ = nullptr;
+    std::size_t end_ = 0;
+    std::atomic<std::size_t> next_{0};
+    //Bumped for every loop so sleeping workers can tell a new one started
+    std::size_t generation_ = 0;
+    int busyWorkers_ = 0;
+    bool stopping_ = false;
+    std::exception_ptr error_;
+
+    void workerLoop();
+    //Claims indices until the loop is exhausted
+    void runItems(const std::function<void(std::size_t)>& body);
+
+public:
+    //nThreads counts the calling thread, so 1 means no workers at all. 0 picks the hardware concurrency
+    explicit ThreadPool(int nThreads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const { return static_cast<int>(workers_.size()) + 1; }
+
+    //Runs body(i) for every i in [0, n) and returns once all are done. The caller takes part.
+    //Calls made from inside a body, or while another thread is driving the pool, run inline on
+    //the calling thread, so the pool is safe to share and nesting never deadlocks.
+    //The first exception thrown by a body is rethrown here
+    void parallelFor(std::size_t n, const std::function<void(std::size_t)>& body);
+};
@@ -79,7 +79,7 @@ MainWindow::MainWindow(QWidget *parent)
         const DataContainer& sample = ds.getContainer(currentRunIndex_);
         
         // Run logic on backend to update counts
-        decisionTree_.getHeadNode()->runInput(sample);
+        decisionTree_.getHeadNode()->runInput(ds, currentRunIndex_);
         
         // Start visual traversal
         scene_->startTraversal(decisionTree_.getHeadNode(), sample);
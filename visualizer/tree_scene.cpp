@@ -107,13 +107,11 @@ void TreeScene::updateNodeRecursive(const Node* node) {
                 const auto& counts = node->getClassCounts();
                 double startAngle = 0.0;
                 
-                // Color map
-                std::unordered_map<std::string, QColor> colors;
-                colors["Iris-setosa"] = Qt::red;
-                colors["Iris-versicolor"] = Qt::green;
-                colors["Iris-virginica"] = Qt::blue;
+                // Color map, indexed by class id (Iris-setosa, Iris-versicolor, Iris-virginica in file order)
+                const std::vector<QColor> colors = {Qt::red, Qt::green, Qt::blue};
                 
-                for (const auto& [label, count] : counts) {
+                for (std::size_t label = 0; label < counts.size(); label++) {
+                    int count = counts[label];
                     if (count == 0) continue;
                     double spanAngle = (double)count / samples * 360.0;
                     
@@ -144,7 +142,7 @@ void TreeScene::updateNodeRecursive(const Node* node) {
                     // Circle is at 0,0. So relative = scene.
                     // So (cx, cy) is correct.
                     
-                    QColor color = colors.count(label) ? colors[label] : Qt::gray;
+                    QColor color = label < colors.size() ? colors[label] : QColor(Qt::gray);
                     slice->setBrush(QBrush(color));
                     slice->setPen(Qt::NoPen);
                     slice->setZValue(0.5); // On top of white circle background